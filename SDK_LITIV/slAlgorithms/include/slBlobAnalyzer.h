@@ -1,7 +1,8 @@
 /*!	\file	slBlobAnalyzer.h
  *	\brief	This file contains classes
  *			slBlobAnalyzer, slDce and slSkel.  There are also
- *			some factory classes for the previous classes.
+ *			some factory classes for the previous classes,
+ *			and the results slBlobResult and slBlobState.
  *
  *	\author		Pier-Luc St-Onge
  *	\date		July 2011
@@ -12,6 +13,9 @@
 
 
 #include "slKeyPoint.h"
+#include "slKeyPointGraph.h"
+#include "slKeyPointScorer.h"
+#include "slDceHierarchy.h"
 
 #include <slContours.h>
 #include <slArgHandler.h>
@@ -21,6 +25,103 @@
 #define ARG_BA "-ba"	//!< Blob analyzer argument on command line
 
 
+///////////////////////////////////////////////////////////////////////////////
+//	slBlobResult
+///////////////////////////////////////////////////////////////////////////////
+
+
+class slBlobAnalyzer;
+
+
+//!	Data of a blob analyzer that depends on the analyzed contours
+/*!
+ *	Each blob analyzer keeps its own data (evolutions, scratch buffers,
+ *	previous frame...) in a class derived from this one, created by the
+ *	analyzer and owned by a slBlobResult.
+ *
+ *	\see		slBlobResult, slBlobAnalyzer
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slBlobState
+{
+public:
+	virtual ~slBlobState();
+
+};
+
+
+//!	Key points of all blobs of the last analysis, owned by the caller
+/*!
+ *	slBlobAnalyzer::analyze() is const: everything it computes goes in the
+ *	caller's slBlobResult.  So one configured analyzer may serve many
+ *	streams, even from many threads, as long as each stream has its own
+ *	result.  A result is reused from frame to frame and keeps its memory
+ *	(the temporal mode of slDce also uses the previous frame of the same
+ *	result).  A result must not be analyzed by many threads at the same time.
+ *
+ *	Once analyzed, a result may be read by many threads: the get functions
+ *	build the key points (and, with slBlobAnalyzer::setLazy(), analyze the
+ *	contours) the first time they are requested, under a lock of the result.
+ *	In lazy mode, getGraph() grows as the contours are read, so it must not
+ *	be browsed while other threads call the get functions.
+ *
+ *	Example:
+ *	\code
+ *	slBlobAnalyzer *ba = slBlobAnalyzerFactory::createInstance(parameters);
+ *	slBlobResult irBlobs, visibleBlobs;
+ *
+ *	ba->analyze(irContours, irBlobs);
+ *	ba->analyze(visibleContours, visibleBlobs);
+ *
+ *	if (irBlobs.hasKeyPoints(contour)) {
+ *		const slKeyPoints &kPts = irBlobs.getKeyPoints(contour);
+ *	}
+ *	\endcode
+ *
+ *	\see		slBlobAnalyzer, slKeyPointGraph, slKeyPoints
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slBlobResult
+{
+public:
+	slBlobResult();				//!< Constructor, no blob
+	virtual ~slBlobResult();
+
+	void clear();				//!< Removes all blobs and the analyzer's data
+
+	// Get Functions
+
+	bool hasKeyPoints(const slContours::const_iterator &contour) const;					//!< Returns true if contour has key points
+	const slKeyPoints& getKeyPoints(const slContours::const_iterator &contour) const;	//!< Returns the key points for that contour
+
+	const slKeyPointGraph& getGraph() const { return graph_; }						//!< Key points of all analyzed contours
+	int getBlob(const slContours::const_iterator &contour) const;						//!< Blob index of that contour in getGraph() (analyzed now if lazy), -1 if none
+
+	const slBlobAnalyzer* getAnalyzer() const { return analyzer_; }		//!< Analyzer of the last analysis, NULL if none
+	const slBlobState* getState() const { return state_; }				//!< Data of that analyzer, NULL if none
+
+private:
+	slBlobResult(const slBlobResult &result);
+	slBlobResult& operator=(const slBlobResult &result);
+
+	friend class slBlobAnalyzer;
+
+	int findBlob(const slContours::const_iterator &contour) const;	// Same as getBlob(), the lock is taken by the caller
+
+private:
+	mutable cv::Mutex mutex_;		// For the get functions that fill the result
+	const slBlobAnalyzer *analyzer_;
+	slBlobState *state_;
+	bool lazy_;
+
+	slKeyPointGraph graph_;										// Key points of all blobs
+	std::map<slContours::const_iterator, int> blobs_;			// Blob index of each contour
+	std::vector<slKeyPointGraph> blobGraphs_;					// One per blob, kept between frames
+	mutable std::map<slContours::const_iterator, slKeyPoints> points_;	// Built by getKeyPoints()
+
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //	slBlobAnalyzer
 ///////////////////////////////////////////////////////////////////////////////
@@ -30,6 +131,29 @@
 /*!
  *	This class has the common interface for all blob analyzers.
  *
+ *	With setNumThreads(), analyzeAllBlobs() analyzes many blobs at the same
+ *	time.  Each thread writes the key points of its own blobs, and the
+ *	analyzers keep one set of scratch buffers per thread.
+ *
+ *	analyze() fills a slBlobResult owned by the caller, without modifying
+ *	the analyzer.  analyzeAllBlobs() and the get functions use a result
+ *	kept in the analyzer, for the programs with only one stream.
+ *
+ *	With setLazy(), analyzeAllBlobs() only forgets the previous contours:
+ *	each contour is analyzed the first time getBlob() or getKeyPoints()
+ *	is called for it, so the holes and blobs nobody reads cost nothing.
+ *	The minimum area is checked before the analysis, as usual.  In that
+ *	mode, the blobs are added to getGraph() in the order they are read.
+ *	The get functions may be called from many threads (the analysis is
+ *	done under a lock of the result), but getGraph() must not be browsed
+ *	while they are called.
+ *
+ *	The key points of all blobs are kept in a flat slKeyPointGraph
+ *	(see getGraph() and getBlob()).  getKeyPoints() builds the slKeyPoints
+ *	of a contour the first time they are requested.
+ *	To score all pairs of key points of two blobs at once, use a
+ *	slKeyPointScorer with the terms given by getScoreTerms().
+ *
  *	Here is a complete example:
  *	\code
  *	slArgProcess argProcess;
@@ -185,21 +309,30 @@ public:
 	void setParameters(const slAH::slParameters& parameters);	//!< Complete configuration of the blob analyzer
 
 	void setMinArea(double minArea);	//!< Minimum area to analyze a blob
+	void setNumThreads(int nbThreads);	//!< Threads used by analyze() (default: 1, 0 for all CPUs)
+	void setLazy(bool lazy);			//!< Analyzes each contour when it is first read (default: false)
 
 	void showParameters() const;		//!< Write configuration to STDOUT
 
 	// Compute functions
 
-	void analyzeAllBlobs(const slContours &contours);								//!< Analyzes all contours individually
-	virtual slKeyPoints analyzeBlob(const slContours::const_iterator &contour) = 0;	//!< Pure virtual analyze function
+	void analyze(const slContours &contours, slBlobResult &result) const;	//!< Analyzes all contours individually in the caller's result, maybe in parallel
+	void analyzeAllBlobs(const slContours &contours);						//!< Same, in the analyzer's result
+	slKeyPoints analyzeBlob(const slContours::const_iterator &contour);		//!< Analyzes one contour, in a result of its own (each call is a frame of one contour)
 
 	virtual float compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 		float diagLength, int offsetX = 0, int offsetY = 0) const = 0;				//!< kPt1.xy + offset.xy vs kPt2.xy, abstract function
+	virtual int getScoreTerms() const = 0;											//!< Terms of compareKeyPoints(), for slKeyPointScorer
 
 	// Get Functions
 
-	bool hasKeyPoints(const slContours::const_iterator &contour) const;					//!< Returns true if contour has key points
-	const slKeyPoints& getKeyPoints(const slContours::const_iterator &contour) const;	//!< Returns the key points for that contour
+	const slBlobResult& getResult() const { return result_; }							//!< Result of analyzeAllBlobs()
+
+	bool hasKeyPoints(const slContours::const_iterator &contour) const { return result_.hasKeyPoints(contour); }				//!< Same as getResult().hasKeyPoints()
+	const slKeyPoints& getKeyPoints(const slContours::const_iterator &contour) const { return result_.getKeyPoints(contour); }	//!< Same as getResult().getKeyPoints()
+
+	const slKeyPointGraph& getGraph() const { return result_.getGraph(); }							//!< Same as getResult().getGraph()
+	int getBlob(const slContours::const_iterator &contour) const { return result_.getBlob(contour); }	//!< Same as getResult().getBlob()
 
 protected:
 	// Set specific parameters
@@ -208,12 +341,48 @@ protected:
 	// Shows (with cout) you function's parameters' getValue
 	virtual void showSubParameters() const = 0;
 
-protected:
-	std::map<slContours::const_iterator, slKeyPoints> points_;
+	// The data of a result for this analyzer, deleted by the result
+	virtual slBlobState* createState() const;
+
+	// Called by analyze() before the analysis of the new contours
+	virtual void clearKeyPoints(slBlobState &state) const;
+
+	// Scratch buffers for nbThreads threads, called before the analysis
+	virtual void reserveThreads(int nbThreads, slBlobState &state) const;
+
+	// Called once per contour before the analysis, never from many threads
+	virtual void prepareBlob(const slContours::const_iterator &contour, slBlobState &state) const;
+
+	// For the get functions of the derived classes: the lock of a result,
+	// and its blob index (analyzed now if lazy) once the lock is taken
+	static cv::Mutex& getMutex(const slBlobResult &result) { return result.mutex_; }
+	static int findBlob(const slBlobResult &result, const slContours::const_iterator &contour) { return result.findBlob(contour); }
+
+	// The analyze function: different contours may be analyzed at the same
+	// time with different thread numbers (0 <= thread < nbThreads).
+	// The key points are added to the blob being built in graph.
+	virtual void analyzeBlobInThread(const slContours::const_iterator &contour, int thread,
+		slBlobState &state, slKeyPointGraph &graph) const = 0;
+
+private:
+	struct slBlobTask;
+	class slBlobBody;
+
+	friend class slBlobResult;
+
+	bool isAnalyzable(const slContours::const_iterator &contour) const;
+	bool addTask(const slContours::const_iterator &contour, bool isLarge, slBlobResult &result,
+		std::vector<slBlobTask> &tasks) const;
+	int analyzeLazily(const slContours::const_iterator &contour, slBlobResult &result) const;
 
 private:
 	bool analyzeHoles_;
 	double minArea_;
+	int nbThreads_;
+	bool lazy_;
+
+	slBlobResult result_;		// Result of analyzeAllBlobs()
+	slBlobResult blobResult_;	// Result of analyzeBlob(), reset at each call
 
 };
 
@@ -225,7 +394,42 @@ private:
  *	points is reached.
  *	One should use setMaxNumOfPoints() to set that maximum number of key points.
  *
- *	\see		slBlobAnalyzer, slDceK, slKeyPoints, slContours
+ *	The complete evolution of each contour is kept (see slDceHierarchy),
+ *	so getKeyPoints() can also give the key points for any other maximum
+ *	number of points without analyzing the contour again.
+ *	getPolygon() gives the same key points as an ordered polygon.
+ *
+ *	With setPreSimplify(), large contours are first approximated by
+ *	slContourEngine::approximate() (Douglas-Peucker), so the evolution
+ *	starts with far fewer points.  The polygon's vertices are then points
+ *	of the simplified contour, so they are still points of the original
+ *	contour.  The simplification is skipped for the contours where it
+ *	would leave the maximum number of points or less.
+ *
+ *	getSimplificationError() measures the final polygon (setMaxNumOfPoints()
+ *	vertices) against the original contour: it is the largest distance
+ *	between a point of the contour and the nearest edge of the polygon.
+ *	As the vertices are points of the contour, it is the Hausdorff distance
+ *	from the contour to the polygon, whatever the pre-simplification or the
+ *	seeding did.  It is computed when requested, in O(N maxPt) for a
+ *	contour of N points.
+ *
+ *	With setTemporal(), each contour is matched to the contour of the previous
+ *	frame whose bounding box overlaps it the most, an external contour with
+ *	an external contour and a hole with a hole.  The vertices of the
+ *	previous polygon are searched on the new contour: the pieces of contour
+ *	between two of them that did not change are replaced by their two
+ *	ends, and only the points of the changed pieces are evolved again.
+ *	When there is no match, or when too much of the contour changed, the
+ *	complete evolution is done.  The hierarchy of a seeded contour only has
+ *	the seeded points.
+ *	So for a seeded contour, getKeyPoints() with more points than
+ *	setMaxNumOfPoints() is not the complete evolution: the extra points
+ *	only come from the changed pieces (the unchanged pieces only kept their
+ *	two ends).  Use the temporal mode only if the other numbers of points
+ *	are not needed.
+ *
+ *	\see		slBlobAnalyzer, slDceK, slDceHierarchy, slKeyPoints, slContours
  *	\author		Pier-Luc St-Onge
  *	\date		July 2011
  */
@@ -240,14 +444,37 @@ public:
 	// Set function(s)
 
 	void setMaxNumOfPoints(int maxPt);									//!< Number of key points to keep on the final contour
+	void setPreSimplify(double distance);								//!< Approximates the contours before the evolution, maximum error in pixels (default: 0, none)
+	void setTemporal(bool temporal, double maxChange = 0.5);			//!< Seeds the evolution with the previous frame's polygons, unless more than maxChange of a contour changed (default: false)
 
 	// Compute functions
 
-	slKeyPoints analyzeBlob(const slContours::const_iterator &contour);	//!< The main compute fonction for DCE method
-
 	virtual float compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 		float diagLength, int offsetX = 0, int offsetY = 0) const;		//!< Returns a global comparison score for DCE key points (the greater value the better)
 
+	static float scoreKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
+		float diagLength, int offsetX = 0, int offsetY = 0);			//!< Same as compareKeyPoints(), without virtual call
+	virtual int getScoreTerms() const;									//!< Euclidean, orientation and K terms
+
+	// Get functions
+
+	using slBlobAnalyzer::getKeyPoints;
+
+	const slDceHierarchy& getHierarchy(const slBlobResult &result,
+		const slContours::const_iterator &contour) const;									//!< Evolution of an analyzed contour (only the seeded points with setTemporal())
+	slKeyPoints getKeyPoints(const slBlobResult &result,
+		const slContours::const_iterator &contour, int maxPt) const;						//!< Key points of an analyzed contour for another number of points
+	void getPolygon(const slBlobResult &result, const slContours::const_iterator &contour,
+		std::vector<slDceVertex> &vertices) const;											//!< Same key points in contour order, empty if not analyzed
+	float getSimplificationError(const slBlobResult &result,
+		const slContours::const_iterator &contour) const;									//!< Largest distance between a point of the contour and the final polygon, 0 if not analyzed
+
+	const slDceHierarchy& getHierarchy(const slContours::const_iterator &contour) const;	//!< Same, in getResult()
+	slKeyPoints getKeyPoints(const slContours::const_iterator &contour, int maxPt) const;	//!< Same, in getResult()
+	void getPolygon(const slContours::const_iterator &contour,
+		std::vector<slDceVertex> &vertices) const;											//!< Same, in getResult()
+	float getSimplificationError(const slContours::const_iterator &contour) const;			//!< Same, in getResult()
+
 protected:
 	// Set specific parameters
 	virtual void setSubParameters(const slAH::slParameters& parameters);
@@ -255,8 +482,50 @@ protected:
 	// Shows (with cout) you function's parameters' getValue
 	virtual void showSubParameters() const;
 
+	virtual slBlobState* createState() const;
+	virtual void clearKeyPoints(slBlobState &state) const;
+	virtual void reserveThreads(int nbThreads, slBlobState &state) const;
+	virtual void prepareBlob(const slContours::const_iterator &contour, slBlobState &state) const;
+
+	// The main compute fonction for DCE method
+	virtual void analyzeBlobInThread(const slContours::const_iterator &contour, int thread,
+		slBlobState &state, slKeyPointGraph &graph) const;
+
+private:
+	// Blob of a frame, for the temporal mode
+	struct slDceTrack {
+		cv::Rect bbox;
+		slContour contour;
+		slContour vertices;		// Final polygon, in contour order
+		bool hole;				// Hole, or external contour
+		int previous;			// Matching track of the previous frame (same kind of contour), -1 if none
+	};
+
+	// Buffers of one thread
+	struct slDceScratch {
+		slContour points;					// Simplified or seeded contour
+		std::vector<int> indexes, previousIndexes;
+	};
+
+	// Data of a slBlobResult
+	struct slDceState: public slBlobState {
+		std::map<slContours::const_iterator, slDceHierarchy> hierarchies;
+		std::map<slContours::const_iterator, int> tracks;		// Index of each contour in current
+		std::vector<slDceTrack> previous, current;				// Blobs of the previous and current frames
+		std::vector<slDceScratch> scratch;						// One per thread
+	};
+
+private:
+	static const slDceState* getState(const slBlobResult &result);
+	bool seed(const slContourView &contour, const slDceTrack &track, slDceScratch &scratch) const;
+	static void findVertices(const slContourView &contour, const slContour &vertices, std::vector<int> &indexes);
+	static float polygonError(const slContourView &contour, const std::vector<slDceVertex> &vertices);
+
 private:
 	int maxPt_;
+	double simplifyDist_;
+	bool temporal_;
+	double maxChange_;
 
 };
 
@@ -274,6 +543,13 @@ private:
  *	returned key points.
  *	The remaining skeleton is finally made of relatively long straight lines.
  *
+ *	The points are sorted in a grid, so Prim's algorithm only compares
+ *	the points near the tree.  When the tree has no near point left (a
+ *	broken skeleton), each remaining point searches the grid in rings of
+ *	cells around it for the nearest new tree point.  The tree is the same
+ *	as with the complete graph, without the matrix of all distances, and
+ *	the heap holds each point at most once.
+ *
  *	\see		slBlobAnalyzer, slSkelRelDist, slKeyPoints, slContours
  *	\author		Pier-Luc St-Onge
  *	\date		July 2011
@@ -288,18 +564,20 @@ public:
 
 	// Set function(s)
 
-	void setSize(cv::Size size);											//!< Size of temporary image buffers (default: 320x240)
+	void setSize(cv::Size size);											//!< Initial memory of temporary image buffers, in pixels (default: 320x240)
 	void setMinHoleArea(unsigned int minHoleArea);							//!< Holes may need to have a significant size (default: 512 square pixels)
 	void setApprox(bool doApprox, double extDist = 0, double intDist = 0);	//!< Contour approximation (default: ext. 3.5 pixels, int. 3.0 pixels)
 	void setPeakThreshold(float peakTh);									//!< Threshold to identify points on distance transformed blob (default: 4.0)
 
 	// Compute functions
 
-	slKeyPoints analyzeBlob(const slContours::const_iterator &contour);		//!< The main compute fonction for skeleton method
-
 	virtual float compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 		float diagLength, int offsetX = 0, int offsetY = 0) const;	//!< Returns a global comparison score for skeleton key points (the greater value the better)
 
+	static float scoreKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
+		float diagLength, int offsetX = 0, int offsetY = 0);		//!< Same as compareKeyPoints(), without virtual call
+	virtual int getScoreTerms() const;								//!< Euclidean, orientation, number of neighbors and relative distance terms
+
 protected:
 	// Set specific parameters
 	virtual void setSubParameters(const slAH::slParameters& parameters);
@@ -307,21 +585,48 @@ protected:
 	// Shows (with cout) you function's parameters' getValue
 	virtual void showSubParameters() const;
 
+	virtual slBlobState* createState() const;
+	virtual void reserveThreads(int nbThreads, slBlobState &state) const;
+
+	// The main compute fonction for skeleton method
+	virtual void analyzeBlobInThread(const slContours::const_iterator &contour, int thread,
+		slBlobState &state, slKeyPointGraph &graph) const;
+
 private:
 	typedef std::vector<unsigned int> UIntVector_t;
 
+	// Image buffers of one thread, the size of the blob being analyzed
+	struct slSkelScratch {
+		slImage1ch imBlob;
+		slImage1fl imDist;
+		slImage1fl imSkel;
+		cv::Point origin;		// Position of the images in the frame
+		slContour approx;		// Approximated contour, kept between blobs
+
+		// The memory only grows, the images are headers on it
+		std::vector<slPixel1ch> blobData;
+		std::vector<slPixel1fl> distData, skelData;
+
+		void reserve(size_t nbPixels);
+		void setRect(const cv::Rect &rect);
+	};
+
+	// Data of a slBlobResult
+	struct slSkelState: public slBlobState {
+		std::vector<slSkelScratch> scratch;		// One per thread
+	};
+
 private:
-	void distanceTransform(const slContours::const_iterator &contour, const cv::Rect &rect);
-	CvPtVector_t getRawPoints(const slContours::const_iterator &contour, const cv::Rect &rect) const;
-	unsigned int* createDistMat(const CvPtVector_t &rawPts) const;
-	void computeParents(UIntVector_t &parents, const unsigned int *dists, unsigned int distInf) const;
-	slKeyPoints computeKeyPoints(const CvPtVector_t &rawPts, UIntVector_t &parents) const;
+	void distanceTransform(const slContours::const_iterator &contour, slSkelScratch &scratch) const;
+	slContourView approximate(const slContourView &contour, double distance, slSkelScratch &scratch) const;
+	void fillContour(const slContourView &contour, const cv::Scalar &color, slSkelScratch &scratch) const;
+	CvPtVector_t getRawPoints(const slSkelScratch &scratch) const;
+	void computeParents(const CvPtVector_t &rawPts, const cv::Rect &rect, UIntVector_t &parents) const;
+	void computeKeyPoints(const CvPtVector_t &rawPts, UIntVector_t &parents, const slSkelScratch &scratch,
+		slKeyPointGraph &graph) const;
 
 private:
 	cv::Size size_;
-	slImage1ch imBlob_;
-	slImage1fl imDist_;
-	slImage1fl imSkel_;
 	//slWindow winSkel_;
 
 	unsigned int minHoleArea_;
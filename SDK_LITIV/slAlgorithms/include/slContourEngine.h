@@ -10,6 +10,7 @@
 
 
 #include "slAlgorithms.h"
+#include "slMorphology.h"
 
 #include <slContours.h>
 #include <slArgHandler.h>
@@ -22,6 +23,14 @@
  *	image before finding the contours.
  *	For example, setClosure() can enable a closure on the image
  *	before slContours::findAll() is called.
+ *	The closure is done by slMorphology on the runs of foreground pixels
+ *	(or with van Herk/Gil-Werman for large rectangular kernels), and gives
+ *	the same result as cv::morphologyEx().
+ *
+ *	With setIncremental(), the foreground image is compared tile by tile
+ *	with the previous one, and only the blobs touching the changed tiles
+ *	are traced again (see slContours::update()).  The other contours are
+ *	kept with the same identity, slContours_const_iterator::id().
  *
  *	\see		slContours, slBlobAnalyzer
  *	\author		Pier-Luc St-Onge
@@ -39,15 +48,22 @@ public:
 
 	void setParameters(const slAH::slParameters& parameters);		//!< To set the parameters
 
-	void setClosure(bool enabled, int w = 3, int h = 3);			//!< To enable the closure filter and set the kernel size
+	void setClosure(bool enabled, int w = 3, int h = 3, bool rect = false);	//!< To enable the closure filter and set the kernel size (ellipse or rectangle)
+
+	void setIncremental(bool enabled, int tileSize = 32);			//!< To trace again only the changed tiles of the foreground
 
 	void showParameters() const;									//!< To show the parameters for the closure
 
 	// Compute functions
 
-	void findContours(slImage1ch &bForeground);		//!< Does a closure on bForeground if needed, then calls slContours::findAll()
+	void findContours(slImage1ch &bForeground);		//!< Does a closure on bForeground if needed, then calls slContours::findAll() or slContours::update()
+	void findContours(slImage1ch &bForeground, const std::vector<cv::Rect> &dirtyRects);	//!< Same, but the caller gives the changed regions of bForeground
 
-	static slContour approximate(const slContour &contour, double distance);	//!< Contour approximation, distance is the maximum error of approximation
+	static void findDirtyTiles(const slImage1ch &previous, const slImage1ch &current,
+		int tileSize, std::vector<cv::Rect> &dirtyRects);	//!< Tiles where previous and current are different
+
+	static slContour approximate(const slContourView &contour, double distance);	//!< Contour approximation, distance is the maximum error of approximation
+	static void approximate(const slContourView &contour, double distance, slContour &approx);	//!< Same, but fills the caller's buffer
 
 	// Get Functions
 
@@ -55,7 +71,14 @@ public:
 
 private:
 	bool doClosure_;
+	bool rectKernel_;
 	cv::Mat kernel_;
+	slMorphology morphology_;
+
+	bool incremental_;
+	int tileSize_;
+	slImage1ch previous_;
+	std::vector<cv::Rect> dirtyRects_, grownRects_;
 
 	slContours contours_;
 
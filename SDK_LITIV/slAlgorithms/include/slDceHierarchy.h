@@ -0,0 +1,107 @@
+/*!	\file	slDceHierarchy.h
+ *	\brief	This file contains class slDceHierarchy.
+ *
+ *	\date		October 2026
+ */
+
+#ifndef SLDCEHIERARCHY_H
+#define SLDCEHIERARCHY_H
+
+
+#include "slAlgorithms.h"
+#include "slKeyPointGraph.h"
+
+#include <slContours.h>
+#include <vector>
+
+
+//!	A vertex of a polygon of the Discrete Curve Evolution
+/*!
+ *	\see		slDceHierarchy::getPolygon(), slDce::getPolygon()
+ *	\date		October 2026
+ */
+struct SLALGORITHMS_DLL_EXPORT slDceVertex
+{
+	cv::Point position;		//!< Point of the contour
+	int index;				//!< Index of the point in the analyzed contour (see slDceHierarchy::point())
+	float k;				//!< K value with the previous and next vertices (see slDceK)
+	float turn;				//!< Turn angle (radians) between the edges before and after the vertex
+};
+
+
+//!	This class keeps the complete Discrete Curve Evolution of one contour
+/*!
+ *	compute() removes the points of the contour one by one, always the
+ *	least significant one (smallest K), until only three points remain.
+ *	The removal order, the K value of each removed point and its two
+ *	neighbors at that time are recorded.
+ *
+ *	Any polygon of the evolution is then rebuilt without evolving again:
+ *	starting from the last three points, the removed points are put back
+ *	between their recorded neighbors, so a polygon of n points costs O(n).
+ *	The polygon can be requested by its number of points, or by a K
+ *	threshold (all points removed while their K was under the threshold).
+ *
+ *	getKeyPoints(n) gives exactly the key points of slDce::analyzeBlob()
+ *	with a maximum of n points.  The same polygon is also available in
+ *	contour order, with the K value and the turn angle of each vertex,
+ *	so no search is needed to walk around it.
+ *
+ *	Example:
+ *	\code
+ *	slDceHierarchy hierarchy;
+ *
+ *	hierarchy.compute(*contour);
+ *
+ *	slKeyPoints coarse = hierarchy.getKeyPoints(8);
+ *	slKeyPoints fine = hierarchy.getKeyPoints(hierarchy.getNumOfPoints(2.0f));
+ *	\endcode
+ *
+ *	\see		slDce, slDceK, slContours
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slDceHierarchy
+{
+public:
+	slDceHierarchy();			//!< Constructor, empty hierarchy
+	virtual ~slDceHierarchy();
+
+	// Compute functions
+
+	void compute(const slContourView &contour);		//!< Complete evolution of the contour, O(N log N)
+
+	// Get functions
+
+	int size() const { return (int)points_.size(); }		//!< Number of points of the contour
+	int getMinNumOfPoints() const;							//!< Number of points at the end of the evolution (3, or less for tiny contours)
+	int getNumOfPoints(float kThreshold) const;				//!< Number of points left when the points with K < kThreshold are removed, O(log N)
+
+	const cv::Point& point(int index) const { return points_[index]; }		//!< Point of the contour at index
+
+	void getPolygon(int nbPoints, std::vector<int> &indexes) const;		//!< Indexes of the polygon's points, in contour order, O(nbPoints)
+	void getPolygon(int nbPoints, std::vector<slDceVertex> &vertices) const;	//!< Vertices of the polygon, in contour order, O(nbPoints)
+	slKeyPoints getKeyPoints(int nbPoints) const;							//!< Key points of the polygon, same as slDce::analyzeBlob()
+	void getKeyPoints(int nbPoints, slKeyPointGraph &graph) const;			//!< Adds the key points of the polygon to the blob being built
+
+	int getNumOfRemovals() const { return (int)removed_.size(); }		//!< Number of recorded removals
+	int getRemoved(int step) const { return removed_[step]; }			//!< Index of the point removed at step
+	float getRemovedK(int step) const { return removedK_[step]; }		//!< K value of that point when it was removed
+
+private:
+	std::vector<cv::Point> points_;		// Points of the contour
+	std::vector<int> removed_;			// Removal order (point indexes)
+	std::vector<int> left_, right_;		// Neighbors of the removed point at that time
+	std::vector<float> removedK_;		// K value of the removed point at that time
+	std::vector<float> maxK_;			// Running maximum of removedK_, NaN counted as infinite
+	std::vector<int> last_;				// Remaining points after the evolution, in contour order
+
+	mutable std::vector<int> prev_, next_;	// Linked list of the evolution, then to rebuild a polygon
+	mutable std::vector<int> polygon_;		// Buffer for getKeyPoints()
+
+	std::vector<float> k_;				// Buffer for compute(): K value of each point
+	std::vector<int> heap_, heapPos_;	// Buffers for compute(): heap of the points by K, position of each point in it
+
+};
+
+
+#endif	// SLDCEHIERARCHY_H
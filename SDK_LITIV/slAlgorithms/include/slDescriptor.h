@@ -19,6 +19,9 @@
 #define DESC_K "K"				//!< Descriptor name for DCE method
 #define DESC_RELDIST "RelDist"	//!< Descriptor name for skeleton method
 
+#define KEYPT_K			0x01	//!< Typed slot of slDceK
+#define KEYPT_RELDIST	0x02	//!< Typed slot of slSkelRelDist
+
 
 //!	This is the base class for all key points' descriptor
 /*!
@@ -64,6 +67,8 @@ public:
 	float scoreK(const slDceK &k2) const;	//!< Comparison function between two k values (negative normalized difference).
 
 	static float compute(const cv::Point &p0, const cv::Point &p1, const cv::Point &p2);		//!< Computes k value, integer components
+	static float compute(const cv::Point &p0, const cv::Point &p1, const cv::Point &p2,
+		float &beta);																			//!< Computes k value and turn angle beta (radians), integer components
 	static float compute(const cv::Point2f &p0, const cv::Point2f &p1, const cv::Point2f &p2);	//!< Computes k value, float components
 
 public:
@@ -19,12 +19,19 @@
 typedef std::vector<cv::Point2f> CvPt2fVector_t;	//!< Vector of points, float components
 typedef std::vector<cv::Point> CvPtVector_t;		//!< Vector of points, integer components
 
+#define KEYPT_ORIENTATION_BUFFER 16	//!< Neighbor pairs whose cos(Theta) scoreOrientation() keeps on the stack
+
 
 //!	This class is the key point
 /*!
  *	A key point has a position (float components only),
  *	neighbor key points and one or many descriptors.
  *
+ *	The descriptors of the blob analyzers (slDceK and slSkelRelDist) are
+ *	kept in typed slots: getK() and getRelDist() need no name search and
+ *	no cast, so the score functions are simple arithmetic.
+ *	Other descriptors are kept by name.
+ *
  *	\see		slBlobAnalyzer, slDescriptor, slKeyPoint.h
  *	\author		Pier-Luc St-Onge
  *	\date		July 2011
@@ -52,10 +59,18 @@ public:
 	void insert(slDescriptor *desc);							//!< Saves a descriptor
 	void remove(const std::string &name);						//!< Removes a descriptor
 
+	void insert(const slDceK &k);								//!< Saves a K value in its slot
+	void insert(const slSkelRelDist &relDist);					//!< Saves a relative distance in its slot
+
+	const slDceK* getK() const
+	{ return (slots_ & KEYPT_K ? &k_ : NULL); }					//!< K value or NULL, no search
+	const slSkelRelDist* getRelDist() const
+	{ return (slots_ & KEYPT_RELDIST ? &relDist_ : NULL); }		//!< Relative distance or NULL, no search
+
 	// Score functions
 	float scoreEuclidean(const slKeyPoint &kPt2, float diagLength,
 		int offsetX = 0, int offsetY = 0) const;			//!< Comparison function, distance between two key points
-	float scoreOrientation(const slKeyPoint &kPt2) const;	//!< Comparison function, orientation of neighbors of two key points
+	float scoreOrientation(const slKeyPoint &kPt2) const;	//!< Comparison function, orientation of neighbors of two key points (no allocation)
 	float scoreNbNeighbors(const slKeyPoint &kPt2) const;	//!< Comparison function, number of neighbors of two key points
 
 private:
@@ -65,7 +80,11 @@ private:
 	cv::Point2f position_;
 	CvPt2fVector_t neighbors_;
 
-	std::map<std::string, slDescriptor*> descriptors_;
+	int slots_;					// Typed slots that are set
+	slDceK k_;
+	slSkelRelDist relDist_;
+
+	std::map<std::string, slDescriptor*> descriptors_;	// Other descriptors
 
 };
 
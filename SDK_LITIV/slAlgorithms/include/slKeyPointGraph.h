@@ -0,0 +1,131 @@
+/*!	\file	slKeyPointGraph.h
+ *	\brief	This file contains class slKeyPointGraph
+ *			and struct slKeyVertex
+ *
+ *	\date		October 2026
+ */
+
+#ifndef SLKEYPOINTGRAPH_H
+#define SLKEYPOINTGRAPH_H
+
+
+#include "slKeyPoint.h"
+
+#include <vector>
+
+
+//!	One key point of a slKeyPointGraph
+/*!
+ *	The descriptors are fields of the vertex, and the neighbors are indexes
+ *	of other vertices of the same graph.
+ *
+ *	\see		slKeyPointGraph, slKeyPoint
+ *	\date		October 2026
+ */
+struct SLALGORITHMS_DLL_EXPORT slKeyVertex
+{
+	cv::Point2f position;	//!< Position of the key point
+	int firstNeighbor;		//!< Index of the first neighbor in slKeyPointGraph::neighbors()
+	int nbNeighbors;		//!< Number of neighbors
+	int descriptors;		//!< Descriptors that are set (KEYPT_K, KEYPT_RELDIST)
+	float k;				//!< K value, DCE method
+	float relDist;			//!< Relative distance, skeleton method
+};
+
+
+//!	This class keeps the key points of many blobs in flat arrays
+/*!
+ *	All vertices are in one contiguous array, the vertices of a blob being
+ *	a slice of it.  All neighbors (vertex indexes) are also in one array,
+ *	the neighbors of a vertex being a slice of it.
+ *	clear() keeps the memory, so the graph of the next frame is built
+ *	almost without allocations.
+ *
+ *	A blob is built between beginBlob() and endBlob().  The vertices of the
+ *	blob are then sorted like slKeyPoints (see CvPoint2fLessThan), and
+ *	vertices at the same position are merged: the neighbors are kept in
+ *	the order of addNeighbor(), and the descriptors set last win.
+ *	So getKeyPoints() gives the same slKeyPoints as if the points were
+ *	inserted in a slKeyPoints.
+ *
+ *	Example:
+ *	\code
+ *	slKeyPointGraph graph;
+ *
+ *	graph.beginBlob();
+ *	int v0 = graph.addVertex(Point2f(10, 10));
+ *	int v1 = graph.addVertex(Point2f(20, 10));
+ *	graph.addNeighbor(v0, v1);
+ *	graph.addNeighbor(v1, v0);
+ *	graph.endBlob();
+ *
+ *	for (int ind = graph.beginVertex(0); ind < graph.endVertex(0); ind++) {
+ *		const slKeyVertex &vertex = graph.vertex(ind);
+ *
+ *		for (int nb = 0; nb < vertex.nbNeighbors; nb++) {
+ *			line(output, Point(vertex.position), Point(graph.neighbor(vertex, nb)), color);
+ *		}
+ *	}
+ *	\endcode
+ *
+ *	\see		slBlobAnalyzer, slKeyVertex, slKeyPoints
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slKeyPointGraph
+{
+public:
+	slKeyPointGraph();			//!< Constructor, no blob
+	virtual ~slKeyPointGraph();
+
+	void clear();											//!< Removes all blobs, keeps the memory
+
+	// Building functions
+
+	int beginBlob();										//!< Starts a new blob, returns its index
+	int addVertex(const cv::Point2f &position);				//!< Adds a key point to the new blob, returns its index in the blob
+	void setK(int vertex, float k);							//!< K value of a key point of the new blob
+	void setRelDist(int vertex, float relDist);				//!< Relative distance of a key point of the new blob
+	void addNeighbor(int vertex, int neighbor);				//!< Adds a neighbor to a key point of the new blob
+	void endBlob();											//!< Sorts and merges the key points of the new blob
+
+	void append(const slKeyPointGraph &graph);				//!< Adds all blobs of another graph
+
+	// Get functions
+
+	int getNumOfBlobs() const { return (int)blobs_.size() - 1; }			//!< Number of blobs
+	int getNumOfVertices() const { return (int)vertices_.size(); }			//!< Number of key points of all blobs
+
+	int beginVertex(int blob) const { return blobs_[blob]; }				//!< Index of the first key point of a blob
+	int endVertex(int blob) const { return blobs_[blob + 1]; }				//!< Index after the last key point of a blob
+
+	const slKeyVertex& vertex(int index) const { return vertices_[index]; }				//!< Key point at index
+	const std::vector<slKeyVertex>& vertices() const { return vertices_; }				//!< All key points
+	const std::vector<int>& neighbors() const { return neighbors_; }					//!< All neighbors (key point indexes)
+
+	const cv::Point2f& neighbor(const slKeyVertex &vertex, int ind) const
+	{ return vertices_[neighbors_[vertex.firstNeighbor + ind]].position; }				//!< Position of a neighbor
+
+	slKeyPoints getKeyPoints(int blob) const;				//!< Key points of a blob, with descriptors
+
+private:
+	struct slArc {
+		int from, to;
+	};
+
+private:
+	std::vector<slKeyVertex> vertices_;		// Vertices of all blobs
+	std::vector<int> neighbors_;			// Neighbors of all vertices
+	std::vector<int> blobs_;				// First vertex of each blob, and the end
+
+	// The blob being built
+	bool building_;
+	std::vector<slKeyVertex> newVertices_;
+	std::vector<slArc> newArcs_;
+	std::vector<int> kStamps_, relDistStamps_;	// When the descriptors were set
+	int stamp_;
+	std::vector<int> order_, newIndex_;
+
+};
+
+
+#endif	// SLKEYPOINTGRAPH_H
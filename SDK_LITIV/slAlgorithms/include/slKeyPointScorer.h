@@ -0,0 +1,119 @@
+/*!	\file	slKeyPointScorer.h
+ *	\brief	This file contains class slKeyPointScorer
+ *			and the score terms
+ *
+ *	\date		October 2026
+ */
+
+#ifndef SLKEYPOINTSCORER_H
+#define SLKEYPOINTSCORER_H
+
+
+#include "slKeyPointGraph.h"
+
+#include <slCore.h>
+#include <float.h>
+#include <vector>
+
+
+#define SCORE_EUCLIDEAN		0x01	//!< slKeyPoint::scoreEuclidean()
+#define SCORE_ORIENTATION	0x02	//!< slKeyPoint::scoreOrientation()
+#define SCORE_NBNEIGHBORS	0x04	//!< slKeyPoint::scoreNbNeighbors()
+#define SCORE_K				0x08	//!< slDceK::scoreK(), if both key points have a K value
+#define SCORE_RELDIST		0x10	//!< slSkelRelDist::scoreRelDist(), if both key points have a relative distance
+
+#define SCORE_REJECTED		(-FLT_MAX)	//!< Score of the pairs rejected by the Euclidean gate
+
+
+//!	This class scores all pairs of key points of two blobs
+/*!
+ *	compare() gives the complete score matrix between the key points of
+ *	two blobs: row i is the i-th key point of the first blob, column j is
+ *	the j-th key point of the second blob (in slKeyPoints order).
+ *	Each score is the sum of the selected terms, so it is the same as
+ *	slBlobAnalyzer::compareKeyPoints() with the terms of the analyzer
+ *	(see slBlobAnalyzer::getScoreTerms()).
+ *
+ *	The key points are first copied in flat arrays kept between calls,
+ *	then each row of the matrix is computed with simple loops: the
+ *	distances and the sigmoids of a whole row, and the cos(Theta) between
+ *	the neighbors of a key point and all neighbors of the other blob, are
+ *	evaluated by the vectorized functions of OpenCV (the terms may differ
+ *	from slKeyPoint::scoreEuclidean() and slKeyPoint::scoreOrientation()
+ *	by float rounding).
+ *
+ *	With setGate(), the pairs farther than a maximum distance are rejected
+ *	before the other terms are computed; their score is SCORE_REJECTED.
+ *
+ *	Example:
+ *	\code
+ *	slKeyPointScorer scorer(ba->getScoreTerms());
+ *	Mat_<float> scores;
+ *
+ *	scorer.setGate(50);
+ *	scorer.compare(ba1->getGraph(), ba1->getBlob(contour1),
+ *		ba2->getGraph(), ba2->getBlob(contour2), diagLength, scores);
+ *	\endcode
+ *
+ *	\see		slBlobAnalyzer, slKeyPointGraph, slKeyPoint
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slKeyPointScorer
+{
+public:
+	slKeyPointScorer(int terms = SCORE_EUCLIDEAN | SCORE_ORIENTATION);	//!< Constructor
+	virtual ~slKeyPointScorer();
+
+	// Set functions
+
+	void setTerms(int terms);				//!< Terms of the score (SCORE_EUCLIDEAN, SCORE_ORIENTATION...)
+	void setGate(float maxDistance);		//!< Rejects the pairs farther than maxDistance (0: no gate)
+
+	// Compute functions
+
+	void compare(const slKeyPointGraph &graph1, int blob1, const slKeyPointGraph &graph2, int blob2,
+		float diagLength, cv::Mat_<float> &scores, int offsetX = 0, int offsetY = 0);	//!< Scores of all pairs, key points of graph1 + offset.xy vs graph2
+
+	void compare(const slKeyPoints &kPts1, const slKeyPoints &kPts2,
+		float diagLength, cv::Mat_<float> &scores, int offsetX = 0, int offsetY = 0);	//!< Scores of all pairs, kPts1.xy + offset.xy vs kPts2.xy
+
+	// Get functions
+
+	int getTerms() const { return terms_; }				//!< Terms of the score
+	float getGate() const { return maxDistance_; }		//!< Maximum distance, 0 if no gate
+
+private:
+	// Key points of one blob, structure of arrays
+	struct slBlobPoints {
+		std::vector<float> x, y, k, relDist;
+		std::vector<int> descriptors;
+		std::vector<int> firstNeighbor, nbNeighbors;
+		std::vector<float> nx, ny, norm2;		// Vectors to the neighbors, and their square lengths
+
+		void clear();
+		void add(const cv::Point2f &position, int descriptors, float k, float relDist);
+		void addNeighbor(const cv::Point2f &neighbor);
+		int size() const { return (int)x.size(); }
+	};
+
+private:
+	void load(const slKeyPointGraph &graph, int blob, slBlobPoints &points) const;
+	void load(const slKeyPoints &kPts, slBlobPoints &points) const;
+	void compare(float diagLength, cv::Mat_<float> &scores, int offsetX, int offsetY);
+	void computeCosTheta(int ind1);
+	float scoreOrientation(int ind1, int ind2) const;
+
+private:
+	int terms_;
+	float maxDistance_;
+
+	// Buffers kept between calls
+	slBlobPoints points1_, points2_;
+	std::vector<float> cosTheta_;			// Neighbors of a key point of the first blob x all neighbors of the second blob
+	std::vector<float> norms_;
+	std::vector<float> row_;
+
+};
+
+
+#endif	// SLKEYPOINTSCORER_H
@@ -0,0 +1,115 @@
+/*!	\file	slMorphology.h
+ *	\brief	This file contains class slMorphology.
+ *
+ *	\date		October 2026
+ */
+
+#ifndef SLMORPHOLOGY_H
+#define SLMORPHOLOGY_H
+
+
+#include "slAlgorithms.h"
+
+#include <slCore.h>
+#include <vector>
+
+
+#define VHGW_MIN_KERNEL 9	//!< Rectangular kernels at least this wide or high use the van Herk/Gil-Werman path
+
+
+//!	This class does a morphological closure on binary images
+/*!
+ *	Foreground masks are mostly empty, so the closure is not computed on
+ *	the pixels but on the runs of foreground pixels of each row.
+ *	A row of the kernel is itself a run (or many runs), so the dilation
+ *	of a row is the union of the shifted runs of the rows above and below,
+ *	and the erosion is the intersection of the shrinked runs.
+ *	The cost is proportional to the number of runs times the kernel height.
+ *
+ *	Large rectangular kernels are separable: they are processed with the
+ *	van Herk/Gil-Werman algorithm which needs a constant number of
+ *	comparisons per pixel, whatever the size of the kernel.
+ *
+ *	Both methods give the same mask as
+ *	<tt>cv::morphologyEx(image, image, MORPH_CLOSE, kernel)</tt>
+ *	with the default anchor and border (nothing grows from outside the image,
+ *	and nothing is eroded by the border).
+ *	The input must be a binary image (0 or not 0), and the output is
+ *	a binary image (PIXEL_1CH_BLACK or PIXEL_1CH_WHITE).
+ *
+ *	Example:
+ *	\code
+ *	slMorphology morphology;
+ *
+ *	morphology.setKernel(getStructuringElement(MORPH_ELLIPSE, Size(5, 5)));
+ *	morphology.close(bForeground);
+ *	\endcode
+ *
+ *	\see		slContourEngine
+ *	\date		October 2026
+ */
+class SLALGORITHMS_DLL_EXPORT slMorphology
+{
+public:
+	slMorphology();			//!< Constructor, 3x3 ellipse kernel
+	virtual ~slMorphology();
+
+	// Set functions
+
+	void setKernel(const cv::Mat &kernel);	//!< Any CV_8U kernel, anchor at (width/2, height/2)
+
+	// Compute functions
+
+	void close(slImage1ch &image);			//!< In-place closure of a binary image
+
+	// Get functions
+
+	const cv::Size& getKernelSize() const { return kernelSize_; }	//!< Size of the kernel
+	bool isSeparable() const { return separable_; }					//!< True if the van Herk/Gil-Werman path is used
+
+private:
+	struct slRun {
+		int begin, end;		// [begin, end)
+	};
+
+	struct slKernelRun {
+		int dy;				// Row offset
+		int first, last;	// Column offsets [first, last]
+	};
+
+	typedef std::vector<slRun> RunVector_t;
+
+private:
+	// Run-length encoded closure
+	void encode(const slImage1ch &image);
+	void dilateRuns();
+	void erodeRuns();
+	void decode(slImage1ch &image) const;
+
+	static void unite(const slRun *runs, const slRun *runsEnd, int first, int last, int width,
+		const RunVector_t &src, RunVector_t &dst);
+	static void intersect(const slRun *runs, const slRun *runsEnd, int first, int last, int width,
+		const RunVector_t &src, RunVector_t &dst, RunVector_t &allowed);
+
+	// van Herk/Gil-Werman closure
+	void closeSeparable(slImage1ch &image);
+	void filterRows(slImage1ch &image, bool dilate);
+	void filterCols(slImage1ch &image, bool dilate);
+
+private:
+	cv::Size kernelSize_;
+	cv::Point anchor_;
+	int width_;				// Width of the encoded image
+	bool separable_;
+	std::vector<slKernelRun> kernelRuns_;
+
+	// Buffers kept between frames
+	RunVector_t runs_, dilated_, eroded_, tmp1_, tmp2_, allowed_;
+	std::vector<int> rowRuns_, rowDilated_, rowEroded_;
+	std::vector<uchar> lineBuf_, prefix_, suffix_;
+	slImage1ch prefixRows_, suffixRows_;
+
+};
+
+
+#endif	// SLMORPHOLOGY_H
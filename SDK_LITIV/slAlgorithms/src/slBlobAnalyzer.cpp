@@ -1,7 +1,9 @@
 #include "slBlobAnalyzer.h"
 #include "slContourEngine.h"
 
+#include <climits>
 #include <iostream>
+#include <limits>
 
 
 using namespace cv;
@@ -9,16 +11,145 @@ using namespace std;
 using namespace slAH;
 
 
+///////////////////////////////////////////////////////////////////////////////
+//	slBlobResult
+///////////////////////////////////////////////////////////////////////////////
+
+
+slBlobState::~slBlobState()
+{
+}
+
+
+slBlobResult::slBlobResult()
+: analyzer_(NULL), state_(NULL), lazy_(false)
+{
+}
+
+
+slBlobResult::~slBlobResult()
+{
+	delete state_;
+}
+
+
+void slBlobResult::clear()
+{
+	delete state_;
+	state_ = NULL;
+	analyzer_ = NULL;
+	lazy_ = false;
+
+	points_.clear();
+	blobs_.clear();
+	graph_.clear();
+}
+
+
+bool slBlobResult::hasKeyPoints(const slContours::const_iterator &contour) const
+{
+	// The contours that the analyzer would analyze
+	if (lazy_) return analyzer_->isAnalyzable(contour);
+
+	return (blobs_.find(contour) != blobs_.end());
+}
+
+
+const slKeyPoints& slBlobResult::getKeyPoints(const slContours::const_iterator &contour) const
+{
+	AutoLock lock(mutex_);
+	map<slContours::const_iterator, slKeyPoints>::const_iterator it = points_.find(contour);
+
+	if (it == points_.end()) {
+		const int blob = findBlob(contour);
+
+		if (blob < 0) {
+			throw slException("slBlobResult::getKeyPoints(): contour does not exist.");
+		}
+
+		// Built from the graph the first time
+		slKeyPoints keyPoints = graph_.getKeyPoints(blob);
+		slKeyPoints &saved = points_[contour];
+
+		saved.swap(keyPoints);
+
+		return saved;
+	}
+
+	return it->second;
+}
+
+
+int slBlobResult::getBlob(const slContours::const_iterator &contour) const
+{
+	AutoLock lock(mutex_);
+
+	return findBlob(contour);
+}
+
+
+int slBlobResult::findBlob(const slContours::const_iterator &contour) const
+{
+	map<slContours::const_iterator, int>::const_iterator it = blobs_.find(contour);
+
+	if (it != blobs_.end()) return it->second;
+
+	if (lazy_ && hasKeyPoints(contour)) {
+		// Only fills the results, like the cache of getKeyPoints()
+		return analyzer_->analyzeLazily(contour, const_cast<slBlobResult&>(*this));
+	}
+
+	return -1;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //	slBlobAnalyzer
 ///////////////////////////////////////////////////////////////////////////////
 
 
 #define ARG_MINAREA "-a"
+#define ARG_THREADS "-j"
+#define ARG_LAZY "-lz"
+
+
+// One blob to analyze, and where to write its key points
+struct slBlobAnalyzer::slBlobTask
+{
+	slContours::const_iterator contour;
+	slKeyPointGraph *graph;
+};
+
+
+// Thread number t analyzes the tasks t, t + nbThreads, t + 2 * nbThreads...
+class slBlobAnalyzer::slBlobBody: public ParallelLoopBody
+{
+public:
+	slBlobBody(const slBlobAnalyzer &analyzer, slBlobState &state, vector<slBlobTask> &tasks, int nbThreads)
+	: analyzer_(analyzer), state_(state), tasks_(tasks), nbThreads_(nbThreads)
+	{
+	}
+
+	void operator()(const Range &range) const
+	{
+		for (int thread = range.start; thread < range.end; thread++) {
+			for (size_t ind = thread; ind < tasks_.size(); ind += nbThreads_) {
+				analyzer_.analyzeBlobInThread(tasks_[ind].contour, thread, state_, *tasks_[ind].graph);
+				tasks_[ind].graph->endBlob();
+			}
+		}
+	}
+
+private:
+	const slBlobAnalyzer &analyzer_;
+	slBlobState &state_;
+	vector<slBlobTask> &tasks_;
+	int nbThreads_;
+};
 
 
 slBlobAnalyzer::slBlobAnalyzer(bool analyzeHoles)
-: analyzeHoles_(analyzeHoles), minArea_(1)
+: analyzeHoles_(analyzeHoles), minArea_(1), nbThreads_(1), lazy_(false)
 {
 }
 
@@ -37,6 +168,8 @@ void slBlobAnalyzer::fillAllParamSpecs(slAH::slParamSpecMap& paramSpecMap)
 void slBlobAnalyzer::fillGlobalParamSpecs(slAH::slParamSpecMap& paramSpecMap)
 {
 	paramSpecMap << (slParamSpec(ARG_MINAREA, "Minimum area") << slSyntax("1..n", "1"));
+	paramSpecMap << (slParamSpec(ARG_THREADS, "Number of threads (0: all CPUs)") << slSyntax("0..n", "1"));
+	paramSpecMap << slParamSpec(ARG_LAZY, "Analyze the contours when they are read");
 }
 
 
@@ -44,6 +177,8 @@ void slBlobAnalyzer::setParameters(const slAH::slParameters& parameters)
 {
 	// Set global parameters
 	setMinArea(atof(parameters.getValue(ARG_MINAREA).c_str()));
+	setNumThreads(atoi(parameters.getValue(ARG_THREADS).c_str()));
+	setLazy(parameters.isParsed(ARG_LAZY));
 
 	// Other parameters
 	setSubParameters(parameters);
@@ -56,11 +191,25 @@ void slBlobAnalyzer::setMinArea(double minArea)
 }
 
 
+void slBlobAnalyzer::setNumThreads(int nbThreads)
+{
+	nbThreads_ = (nbThreads > 0 ? nbThreads : getNumberOfCPUs());
+}
+
+
+void slBlobAnalyzer::setLazy(bool lazy)
+{
+	lazy_ = lazy;
+}
+
+
 void slBlobAnalyzer::showParameters() const
 {
 	cout << "--- slBlobAnalyzer ---" << endl;
 
 	cout << "Minimum area : " << minArea_ << endl;
+	cout << "Threads : " << nbThreads_ << endl;
+	cout << "Lazy : " << (lazy_ ? "yes" : "no") << endl;
 
 	cout << endl;
 
@@ -68,45 +217,163 @@ void slBlobAnalyzer::showParameters() const
 }
 
 
-void slBlobAnalyzer::analyzeAllBlobs(const slContours &contours)
+void slBlobAnalyzer::analyze(const slContours &contours, slBlobResult &result) const
 {
-	points_.clear();
+	// The data of another analyzer is not reused
+	if (result.analyzer_ != this) {
+		result.clear();
+		result.analyzer_ = this;
+		result.state_ = createState();
+	}
+
+	result.lazy_ = lazy_;
+	result.points_.clear();
+	result.blobs_.clear();
+	result.graph_.clear();
+	clearKeyPoints(*result.state_);
+
+	// Each contour will be analyzed by getBlob()
+	if (lazy_) return;
+
+	// The maps are only modified here, the threads write in their own graph
+	vector<slBlobTask> tasks;
 
 	// For each external contour
 	for (slContours::const_iterator contour = contours.begin();
 		!contour.isNull(); contour = contour.next())
 	{
-		points_[contour] = (contourArea(contour.mat()) >= minArea_ ?
-			analyzeBlob(contour) : slKeyPoints());
+		const bool isLarge = addTask(contour, true, result, tasks);
 
 		if (analyzeHoles_) {
-			// For each hole or internal contour
+			// For each hole or internal contour, smaller than its blob
 			for (slContours::const_iterator child = contour.child();
 				!child.isNull(); child = child.next())
 			{
-				points_[child] = (contourArea(child.mat()) >= minArea_ ?
-					analyzeBlob(child) : slKeyPoints());
+				addTask(child, isLarge, result, tasks);
 			}
 		}
 	}
+
+	const int nbThreads = std::min(nbThreads_, (int)tasks.size());
+
+	if (nbThreads > 1) {
+		reserveThreads(nbThreads, *result.state_);
+		parallel_for_(Range(0, nbThreads), slBlobBody(*this, *result.state_, tasks, nbThreads));
+	}
+	else {
+		reserveThreads(1, *result.state_);
+		slBlobBody(*this, *result.state_, tasks, 1)(Range(0, 1));
+	}
+
+	// All blobs in one graph, in the order of the contours
+	for (size_t blob = 0; blob < result.blobs_.size(); blob++) {
+		result.graph_.append(result.blobGraphs_[blob]);
+	}
 }
 
 
-bool slBlobAnalyzer::hasKeyPoints(const slContours::const_iterator &contour) const
+void slBlobAnalyzer::analyzeAllBlobs(const slContours &contours)
 {
-	return (points_.find(contour) != points_.end());
+	analyze(contours, result_);
 }
 
 
-const slKeyPoints& slBlobAnalyzer::getKeyPoints(const slContours::const_iterator &contour) const
+slKeyPoints slBlobAnalyzer::analyzeBlob(const slContours::const_iterator &contour)
 {
-	map<slContours::const_iterator, slKeyPoints>::const_iterator it = points_.find(contour);
+	slKeyPointGraph graph;
 
-	if (it == points_.end()) {
-		throw slException("slBlobAnalyzer::getNeighborhood(): contour does not exist.");
+	// Its own result, so getResult() is not touched
+	if (blobResult_.analyzer_ != this) {
+		blobResult_.clear();
+		blobResult_.analyzer_ = this;
+		blobResult_.state_ = createState();
 	}
 
-	return it->second;
+	// The contour of the last call becomes the previous frame, as in analyze()
+	clearKeyPoints(*blobResult_.state_);
+	reserveThreads(1, *blobResult_.state_);
+	prepareBlob(contour, *blobResult_.state_);
+
+	graph.beginBlob();
+	analyzeBlobInThread(contour, 0, *blobResult_.state_, graph);
+	graph.endBlob();
+
+	return graph.getKeyPoints(0);
+}
+
+
+bool slBlobAnalyzer::addTask(const slContours::const_iterator &contour, bool isLarge, slBlobResult &result,
+							 vector<slBlobTask> &tasks) const
+{
+	const int blob = (int)result.blobs_.size();
+	result.blobs_[contour] = blob;
+
+	if ((int)result.blobGraphs_.size() <= blob) result.blobGraphs_.resize(blob + 1);
+
+	slKeyPointGraph &graph = result.blobGraphs_[blob];
+	graph.clear();
+	graph.beginBlob();
+
+	if (isLarge && contourArea(contour.mat()) >= minArea_) {
+		prepareBlob(contour, *result.state_);
+
+		slBlobTask task = {contour, &graph};
+		tasks.push_back(task);
+
+		return true;
+	}
+	else {
+		graph.endBlob();	// No key points
+		return false;
+	}
+}
+
+
+int slBlobAnalyzer::analyzeLazily(const slContours::const_iterator &contour, slBlobResult &result) const
+{
+	const int blob = result.graph_.beginBlob();
+	result.blobs_[contour] = blob;
+
+	if (contourArea(contour.mat()) >= minArea_) {
+		reserveThreads(1, *result.state_);
+		prepareBlob(contour, *result.state_);
+		analyzeBlobInThread(contour, 0, *result.state_, result.graph_);
+	}
+
+	result.graph_.endBlob();
+
+	return blob;
+}
+
+
+bool slBlobAnalyzer::isAnalyzable(const slContours::const_iterator &contour) const
+{
+	// The contours analyze() would analyze: external ones, and their holes
+	if (contour.isNull()) return false;
+	if (contour.parent().isNull()) return true;
+
+	return (analyzeHoles_ && contour.parent().parent().isNull());
+}
+
+
+slBlobState* slBlobAnalyzer::createState() const
+{
+	return new slBlobState;
+}
+
+
+void slBlobAnalyzer::clearKeyPoints(slBlobState &state) const
+{
+}
+
+
+void slBlobAnalyzer::reserveThreads(int nbThreads, slBlobState &state) const
+{
+}
+
+
+void slBlobAnalyzer::prepareBlob(const slContours::const_iterator &contour, slBlobState &state) const
+{
 }
 
 
@@ -116,10 +383,30 @@ const slKeyPoints& slBlobAnalyzer::getKeyPoints(const slContours::const_iterator
 
 
 #define ARG_MAXPT "-n"
+#define ARG_SIMPLIFY "-s"
+#define ARG_TEMPORAL "-t"
+
+#define DCE_MIN_OVERLAP 0.5		// Minimum intersection over union of the bounding boxes of a track
+
+
+// Square distance between a point and the segment [a, b]
+static double segmentDistance2(const Point &pt, const Point &a, const Point &b)
+{
+	double abx = b.x - a.x, aby = b.y - a.y;
+	double apx = pt.x - a.x, apy = pt.y - a.y;
+	double length2 = abx * abx + aby * aby;
+	double t = (length2 > 0 ? (apx * abx + apy * aby) / length2 : 0);
+
+	t = (t < 0 ? 0 : (t > 1 ? 1 : t));
+	apx -= t * abx;
+	apy -= t * aby;
+
+	return apx * apx + apy * apy;
+}
 
 
 slDce::slDce()
-: slBlobAnalyzer(true), maxPt_(12)
+: slBlobAnalyzer(true), maxPt_(12), simplifyDist_(0), temporal_(false), maxChange_(0.5)
 {
 }
 
@@ -132,12 +419,28 @@ slDce::~slDce()
 void slDce::fillParamSpecs(slAH::slParamSpecMap& paramSpecMap)
 {
 	paramSpecMap << (slParamSpec(ARG_MAXPT, "Maximum number of points") << slSyntax("3..n", "12"));
+	paramSpecMap << (slParamSpec(ARG_SIMPLIFY, "Pre-simplification (distance)") << slSyntax("distance", "1.0"));
+	paramSpecMap << (slParamSpec(ARG_TEMPORAL, "Temporal DCE (max. change)") << slSyntax("0..1", "0.5"));
 }
 
 
 void slDce::setSubParameters(const slParameters& parameters)
 {
 	setMaxNumOfPoints(atoi(parameters.getValue(ARG_MAXPT).c_str()));
+
+	if (parameters.isParsed(ARG_SIMPLIFY)) {
+		setPreSimplify(atof(parameters.getValue(ARG_SIMPLIFY).c_str()));
+	}
+	else {
+		setPreSimplify(0);
+	}
+
+	if (parameters.isParsed(ARG_TEMPORAL)) {
+		setTemporal(true, atof(parameters.getValue(ARG_TEMPORAL).c_str()));
+	}
+	else {
+		setTemporal(false);
+	}
 }
 
 
@@ -147,100 +450,344 @@ void slDce::setMaxNumOfPoints(int maxPt)
 }
 
 
+void slDce::setPreSimplify(double distance)
+{
+	simplifyDist_ = (distance > 0 ? distance : 0);
+}
+
+
+void slDce::setTemporal(bool temporal, double maxChange)
+{
+	temporal_ = temporal;
+	maxChange_ = (maxChange > 0 ? (maxChange < 1 ? maxChange : 1) : 0);
+}
+
+
 void slDce::showSubParameters() const
 {
 	cout << "--- slDce ---" << endl;
 	cout << "Max. Num. of points : " << maxPt_ << endl;
+	cout << "Pre-simplification  : " << simplifyDist_ << endl;
+	cout << "Temporal (max. change) : " << (temporal_ ? maxChange_ : 0) << endl;
+}
+
+
+slBlobState* slDce::createState() const
+{
+	return new slDceState;
+}
+
+
+void slDce::clearKeyPoints(slBlobState &state) const
+{
+	slDceState &dceState = static_cast<slDceState&>(state);
+
+	dceState.hierarchies.clear();
+
+	// The blobs of this frame become the previous ones
+	dceState.tracks.clear();
+	dceState.previous.swap(dceState.current);
+	dceState.current.clear();
 }
 
 
-slKeyPoints slDce::analyzeBlob(const slContours::const_iterator &contour)
+void slDce::reserveThreads(int nbThreads, slBlobState &state) const
 {
-	struct PtDCE {
-		cv::Point pt;
-		float K;
-		PtDCE *left;
-		PtDCE *right;
-	};
+	slDceState &dceState = static_cast<slDceState&>(state);
+
+	if ((int)dceState.scratch.size() < nbThreads) dceState.scratch.resize(nbThreads);
+}
+
 
-	if (contour->empty()) return slKeyPoints();
+void slDce::prepareBlob(const slContours::const_iterator &contour, slBlobState &state) const
+{
+	slDceState &dceState = static_cast<slDceState&>(state);
 
-	// Copy all points into a vector
-	int totalPt = (int)contour->size();
-	vector<PtDCE> points(totalPt);
+	// Created here, so the threads only search the maps
+	dceState.hierarchies[contour];
 
-	for (int ind = 0; ind < totalPt; ind++) {
-		points[ind].pt = (*contour)[ind];
+	if (!temporal_) return;
+
+	// Contour of the previous frame that overlaps the most, hole for a hole
+	slDceTrack track;
+	track.bbox = boundingRect(contour.mat());
+	track.hole = !contour.parent().isNull();
+	track.previous = -1;
+
+	double bestOverlap = DCE_MIN_OVERLAP;
+
+	for (size_t ind = 0; ind < dceState.previous.size(); ind++) {
+		if (dceState.previous[ind].hole != track.hole) continue;
+
+		const Rect &bbox = dceState.previous[ind].bbox;
+		double inter = (track.bbox & bbox).area();
+		double overlap = inter / (track.bbox.area() + bbox.area() - inter);
+
+		if (overlap >= bestOverlap) {
+			bestOverlap = overlap;
+			track.previous = (int)ind;
+		}
 	}
 
-	// Create a circular double-linked list
-	PtDCE *head = &points.front();
+	dceState.tracks[contour] = (int)dceState.current.size();
+	dceState.current.push_back(track);
+}
 
-	for (int ind = 1; ind < totalPt; ind++)
-	{
-		head[ind - 1].right = &head[ind];
-		head[ind].left = &head[ind - 1];
+
+void slDce::analyzeBlobInThread(const slContours::const_iterator &contour, int thread,
+								slBlobState &state, slKeyPointGraph &graph) const
+{
+	if (contour->empty()) return;
+
+	slDceState &dceState = static_cast<slDceState&>(state);
+	slDceScratch &scratch = dceState.scratch[thread];
+	slDceTrack *track = (temporal_ ? &dceState.current[dceState.tracks.find(contour)->second] : NULL);
+	slContourView points = *contour;
+
+	if (track != NULL && track->previous >= 0 && seed(*contour, dceState.previous[track->previous], scratch)) {
+		// Only the changed pieces of the contour, between the previous vertices
+		points = scratch.points;
+	}
+	else if (simplifyDist_ > 0) {
+		// Fewer points to evolve, if enough are left for the final polygon
+		slContourEngine::approximate(*contour, simplifyDist_, scratch.points);
+
+		if ((int)scratch.points.size() > maxPt_) points = scratch.points;
+	}
+
+	// Complete evolution, kept for other numbers of points
+	slDceHierarchy &hierarchy = dceState.hierarchies.find(contour)->second;
+	hierarchy.compute(points);
+
+	// Kept for the next frame
+	if (track != NULL) {
+		track->contour.assign(contour->begin(), contour->end());
+		hierarchy.getPolygon(maxPt_, scratch.indexes);
+
+		track->vertices.resize(scratch.indexes.size());
+		for (size_t ind = 0; ind < scratch.indexes.size(); ind++) {
+			track->vertices[ind] = hierarchy.point(scratch.indexes[ind]);
+		}
+	}
+
+	hierarchy.getKeyPoints(maxPt_, graph);
+}
+
+
+const slDce::slDceState* slDce::getState(const slBlobResult &result)
+{
+	return dynamic_cast<const slDceState*>(result.getState());
+}
+
+
+const slDceHierarchy& slDce::getHierarchy(const slBlobResult &result, const slContours::const_iterator &contour) const
+{
+	AutoLock lock(getMutex(result));
+	findBlob(result, contour);	// Analyzed now if lazy
+
+	const slDceState *state = getState(result);
+
+	if (state != NULL) {
+		map<slContours::const_iterator, slDceHierarchy>::const_iterator it = state->hierarchies.find(contour);
+		if (it != state->hierarchies.end()) return it->second;
+	}
+
+	throw slException("slDce::getHierarchy(): contour has not been analyzed.");
+}
+
+
+slKeyPoints slDce::getKeyPoints(const slBlobResult &result, const slContours::const_iterator &contour, int maxPt) const
+{
+	return getHierarchy(result, contour).getKeyPoints(maxPt);
+}
+
+
+void slDce::getPolygon(const slBlobResult &result, const slContours::const_iterator &contour,
+					   std::vector<slDceVertex> &vertices) const
+{
+	AutoLock lock(getMutex(result));
+	findBlob(result, contour);	// Analyzed now if lazy
+
+	const slDceState *state = getState(result);
+	vertices.clear();
+
+	if (state != NULL) {
+		map<slContours::const_iterator, slDceHierarchy>::const_iterator it = state->hierarchies.find(contour);
+		if (it != state->hierarchies.end()) it->second.getPolygon(maxPt_, vertices);
 	}
-	points.back().right = head;
-	head->left = &points.back();
+}
+
+
+float slDce::getSimplificationError(const slBlobResult &result, const slContours::const_iterator &contour) const
+{
+	vector<slDceVertex> vertices;
+
+	// Measured now, only for the contours that are asked
+	getPolygon(result, contour, vertices);
+
+	return polygonError(*contour, vertices);
+}
+
+
+const slDceHierarchy& slDce::getHierarchy(const slContours::const_iterator &contour) const
+{
+	return getHierarchy(getResult(), contour);
+}
+
+
+slKeyPoints slDce::getKeyPoints(const slContours::const_iterator &contour, int maxPt) const
+{
+	return getKeyPoints(getResult(), contour, maxPt);
+}
+
+
+void slDce::getPolygon(const slContours::const_iterator &contour, std::vector<slDceVertex> &vertices) const
+{
+	getPolygon(getResult(), contour, vertices);
+}
+
+
+float slDce::getSimplificationError(const slContours::const_iterator &contour) const
+{
+	return getSimplificationError(getResult(), contour);
+}
+
+
+bool slDce::seed(const slContourView &contour, const slDceTrack &track, slDceScratch &scratch) const
+{
+	const slContourView previous = track.contour;
+	const int nbPoints = (int)contour.size();
+	const int nbPrevious = (int)previous.size();
+	const int nbVertices = (int)track.vertices.size();
 
-	// Compute K for each point
-	for (int ind = 0; ind < totalPt; ind++) {
-		head[ind].K = slDceK::compute(head[ind].left->pt, head[ind].pt, head[ind].right->pt);
+	// The previous vertices on both contours
+	findVertices(contour, track.vertices, scratch.indexes);
+	findVertices(previous, track.vertices, scratch.previousIndexes);
+
+	int nbAnchors = 0;
+
+	for (int ind = 0; ind < nbVertices; ind++) {
+		if (scratch.indexes[ind] < 0 || scratch.previousIndexes[ind] < 0) continue;
+
+		// Anchors found on both contours, packed at the beginning
+		scratch.indexes[nbAnchors] = scratch.indexes[ind];
+		scratch.previousIndexes[nbAnchors] = scratch.previousIndexes[ind];
+		nbAnchors++;
 	}
 
-	// Loop while the number of remaining points is too high
-	while (totalPt > maxPt_) {
-		// Find the least significant point
-		PtDCE *ptrMin = head;
+	if (nbAnchors < 3) return false;
+
+	// Each piece between two anchors is kept whole if it changed, else only its first anchor
+	const int maxChanged = (int)(maxChange_ * nbPoints);
+	int nbChanged = 0;
+
+	scratch.points.clear();
+
+	for (int ind = 0; ind < nbAnchors; ind++) {
+		const int start = scratch.indexes[ind];
+		const int previousStart = scratch.previousIndexes[ind];
+		const int length = (scratch.indexes[(ind + 1) % nbAnchors] - start + nbPoints) % nbPoints;
+		const int previousLength = (scratch.previousIndexes[(ind + 1) % nbAnchors] - previousStart + nbPrevious) % nbPrevious;
+
+		bool changed = (length != previousLength);
+
+		for (int pt = 1; pt < length && !changed; pt++) {
+			changed = (contour[(start + pt) % nbPoints] != previous[(previousStart + pt) % nbPrevious]);
+		}
+
+		scratch.points.push_back(contour[start]);
+
+		if (changed) {
+			nbChanged += length - 1;
+			if (nbChanged > maxChanged) return false;
 
-		for (PtDCE *ptr = head->right; ptr != head; ptr = ptr->right) {
-			if (ptr->K < ptrMin->K) ptrMin = ptr;
+			for (int pt = 1; pt < length; pt++) {
+				scratch.points.push_back(contour[(start + pt) % nbPoints]);
+			}
 		}
+	}
+
+	return true;
+}
 
-		// Delete the least significant point
-		totalPt--;
-		if (head == ptrMin) head = head->right;
 
-		// Join the neighbors together
-		ptrMin->left->right = ptrMin->right;
-		ptrMin->right->left = ptrMin->left;
+void slDce::findVertices(const slContourView &contour, const slContour &vertices, std::vector<int> &indexes)
+{
+	const int nbPoints = (int)contour.size();
+	const int nbVertices = (int)vertices.size();
+	int pos = -1, end = 0;		// Search in ]pos, end[, before the first vertex found
+
+	indexes.assign(nbVertices, -1);
+
+	for (int ind = 0; ind < nbVertices; ind++) {
+		if (pos < 0) {
+			// Anywhere, for the first vertex found
+			for (int pt = 0; pt < nbPoints; pt++) {
+				if (contour[pt] == vertices[ind]) {
+					pos = pt;
+					end = pt + nbPoints;
+					break;
+				}
+			}
 
-		// Update neighbors' K value
-		ptrMin->left->K = slDceK::compute(ptrMin->left->left->pt, ptrMin->left->pt, ptrMin->left->right->pt);
-		ptrMin->right->K = slDceK::compute(ptrMin->right->left->pt, ptrMin->right->pt, ptrMin->right->right->pt);
+			if (pos >= 0) indexes[ind] = pos;
+		}
+		else {
+			// After the last vertex found, so the indexes stay in contour order
+			for (int pt = pos + 1; pt < end; pt++) {
+				if (contour[pt % nbPoints] == vertices[ind]) {
+					pos = pt;
+					indexes[ind] = pt % nbPoints;
+					break;
+				}
+			}
+		}
 	}
+}
 
-	// Return remaining points
-	slKeyPoints keyPoints;
 
-	for (int ind = 0; ind < totalPt; ind++) {
-		CvPoint2D32f position = cvPointTo32f(head->pt);
-		slKeyPoint &keyPoint = keyPoints[position];
+float slDce::polygonError(const slContourView &contour, const std::vector<slDceVertex> &vertices)
+{
+	const int nbPoints = (int)contour.size();
+	const int nbVertices = (int)vertices.size();
+
+	if (nbVertices == 0) return 0;
+
+	// Distance of each point of the contour to the nearest edge of the polygon
+	double maxDist2 = 0;
 
-		// Save its descriptors
-		keyPoint.moveTo(position);
-		keyPoint.insert(new slDceK(head->K));
-		keyPoint.insert(head->left->pt);
-		keyPoint.insert(head->right->pt);
+	for (int ind = 0; ind < nbPoints; ind++) {
+		double dist2 = numeric_limits<double>::max();
 
-		head = head->right;
+		for (int edge = 0; edge < nbVertices && dist2 > maxDist2; edge++) {
+			dist2 = min(dist2, segmentDistance2(contour[ind], vertices[edge].position, vertices[(edge + 1) % nbVertices].position));
+		}
+
+		maxDist2 = max(maxDist2, dist2);
 	}
 
-	return keyPoints;
+	return (float)std::sqrt(maxDist2);
 }
 
 
 float slDce::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 							  float diagLength, int offsetX, int offsetY) const
+{
+	return scoreKeyPoints(kPt1, kPt2, diagLength, offsetX, offsetY);
+}
+
+
+float slDce::scoreKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
+							float diagLength, int offsetX, int offsetY)
 {
 	float score = 0;
 
 	score += kPt1.scoreEuclidean(kPt2, diagLength, offsetX, offsetY);
 	score += kPt1.scoreOrientation(kPt2);
 
-	const slDceK *k1 = dynamic_cast<const slDceK*>(kPt1.find(DESC_K));
-	const slDceK *k2 = dynamic_cast<const slDceK*>(kPt2.find(DESC_K));
+	// Typed slots, no search by name
+	const slDceK *k1 = kPt1.getK();
+	const slDceK *k2 = kPt2.getK();
 
 	if (k1 != NULL && k2 != NULL) score += k1->scoreK(*k2);
 
@@ -248,6 +795,12 @@ float slDce::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 }
 
 
+int slDce::getScoreTerms() const
+{
+	return SCORE_EUCLIDEAN | SCORE_ORIENTATION | SCORE_K;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //	slSkel
 ///////////////////////////////////////////////////////////////////////////////
@@ -258,6 +811,8 @@ float slDce::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 #define ARG_APPROX "-ap"
 #define ARG_PEAKTH "-pt"
 
+#define SKEL_GRID_CELL 8	// Side of the grid cells of computeParents(), in pixels
+
 
 slSkel::slSkel(): slBlobAnalyzer(),
 size_(320, 240), minHoleArea_(512), doApprox_(false), extDist_(3.5), intDist_(3.0),
@@ -313,10 +868,46 @@ void slSkel::setSubParameters(const slParameters& parameters)
 void slSkel::setSize(cv::Size size)
 {
 	size_ = size;
+}
+
+
+slBlobState* slSkel::createState() const
+{
+	return new slSkelState;
+}
+
 
-	imBlob_.create(size);
-	imDist_.create(size);
-	imSkel_.create(size);
+void slSkel::reserveThreads(int nbThreads, slBlobState &state) const
+{
+	vector<slSkelScratch> &scratch = static_cast<slSkelState&>(state).scratch;
+
+	// New buffers have the current size, the others keep their memory
+	for (int ind = (int)scratch.size(); ind < nbThreads; ind++) {
+		scratch.push_back(slSkelScratch());
+		scratch.back().reserve((size_t)size_.area());
+	}
+}
+
+
+void slSkel::slSkelScratch::reserve(size_t nbPixels)
+{
+	if (blobData.size() < nbPixels) {
+		blobData.resize(nbPixels);
+		distData.resize(nbPixels);
+		skelData.resize(nbPixels);
+	}
+}
+
+
+void slSkel::slSkelScratch::setRect(const cv::Rect &rect)
+{
+	reserve((size_t)rect.area());
+
+	// Continuous images of the rect's size, on the memory of this thread
+	imBlob = slImage1ch(rect.height, rect.width, &blobData[0]);
+	imDist = slImage1fl(rect.height, rect.width, &distData[0]);
+	imSkel = slImage1fl(rect.height, rect.width, &skelData[0]);
+	origin = rect.tl();
 }
 
 
@@ -356,95 +947,101 @@ void slSkel::showSubParameters() const
 }
 
 
-slKeyPoints slSkel::analyzeBlob(const slContours::const_iterator &contour)
+void slSkel::analyzeBlobInThread(const slContours::const_iterator &contour, int thread,
+								 slBlobState &state, slKeyPointGraph &graph) const
 {
-	if (contour->empty()) return slKeyPoints();
+	if (contour->empty()) return;
+
+	slSkelScratch &scratch = static_cast<slSkelState&>(state).scratch[thread];
 
 	// Prepare the images (buffers)
-	Rect rect = boundingRect(*contour);
+	Rect rect = boundingRect(contour.mat());
 	rect.x -= 1; rect.width += 2;	// Encadrer d'un pixel pour
 	rect.y -= 1; rect.height += 2;	// la transforme distance
 
-	int width = size_.width, height = size_.height;
-	if (width < rect.x + rect.width) width = rect.x + rect.width;
-	if (height < rect.y + rect.height) height = rect.y + rect.height;
-	if (width > size_.width || height > size_.height) setSize(cvSize(width, height));
+	// Images of the rect only, the memory of this thread grows if needed
+	scratch.setRect(rect);
 
 	// Fill with black
-	imBlob_ = PIXEL_1CH_BLACK;
-	imDist_ = 0;
+	scratch.imBlob = PIXEL_1CH_BLACK;
 
 	// Compute the distance-transformed image, highligt the peaks with kernel 181
-	distanceTransform(contour, rect);
+	distanceTransform(contour, scratch);
 
 	// Extract raw points (peaks)
-	CvPtVector_t rawPts = getRawPoints(contour, rect);
+	CvPtVector_t rawPts = getRawPoints(scratch);
 
-	// Create complete graph from all points
-	const unsigned int N = rawPts.size(), distInf = width * width + height * height + 1;
-	unsigned int *dists = createDistMat(rawPts);
+	// Apply Prim's algorithm (as seen on Wikipedia) on the points near each other
+	const unsigned int N = rawPts.size();
 	UIntVector_t parents(N, N);
 
-	// Apply Prim's algorithm (as seen on Wikipedia)
-	computeParents(parents, dists, distInf);
+	computeParents(rawPts, rect, parents);
 
-	// No need to keep dists at this point
-	delete [] dists;
 	// Search for keypoints
-	return computeKeyPoints(rawPts, parents);
+	computeKeyPoints(rawPts, parents, scratch, graph);
 }
 
 
-void slSkel::distanceTransform(const slContours::const_iterator &contour, const cv::Rect &rect)
+void slSkel::distanceTransform(const slContours::const_iterator &contour, slSkelScratch &scratch) const
 {
 	const Scalar BLACK(0), WHITE(255);
 
-	// Compute approximated external contour
-	slContours approxExt(doApprox_ ? slContourEngine::approximate(*contour, extDist_) : *contour);
-
-	// Fill with approximated contour in white
-	drawContours(imBlob_, approxExt.all(), 0, WHITE, CV_FILLED, 8, approxExt.hierarchy(), 0);
+	// Fill with approximated external contour in white
+	fillContour(doApprox_ ? approximate(*contour, extDist_, scratch) : *contour, WHITE, scratch);
 
 	// For each hole
 	for (slContours::const_iterator hole = contour.child(); !hole.isNull(); hole = hole.next()) {
 		// If the hole is large enough
 		if (fabs(contourArea(hole.mat())) >= minHoleArea_) {
-			// Compute approximated internal contour
-			slContours approxInt(doApprox_ ? slContourEngine::approximate(*hole, intDist_) : *hole);
-
-			// Paint the hole in black
-			drawContours(imBlob_, approxInt.all(), 0, BLACK, CV_FILLED, 8, approxInt.hierarchy(), 0);
+			// Paint the approximated internal contour in black
+			fillContour(doApprox_ ? approximate(*hole, intDist_, scratch) : *hole, BLACK, scratch);
 		}
 	}
 
-	// Optimize computation by using ROI
-	Mat imBlob(imBlob_, rect);
-	Mat imDist(imDist_, rect);
-	Mat imSkel(imSkel_, rect);
-
-	// Apply distance transformation on imBlob and highlight peaks in imSkel
-	cv::distanceTransform(imBlob, imDist, CV_DIST_L2, 3);
-	filter2D(imDist, imSkel, -1, kernel181_);
+	// Apply distance transformation on imBlob and highlight peaks in imSkel.
+	// Outside the images, the distance is 0 like around a ROI of a black frame.
+	cv::distanceTransform(scratch.imBlob, scratch.imDist, CV_DIST_L2, 3);
+	filter2D(scratch.imDist, scratch.imSkel, -1, kernel181_, Point(-1, -1), 0, BORDER_CONSTANT);
 
 	// Normalize imDist for the feature points' values
-	normalize(imDist, imDist, 0, 1, NORM_MINMAX);
+	normalize(scratch.imDist, scratch.imDist, 0, 1, NORM_MINMAX);
 
 	//winSkel_.show(imSkel_);	waitKey();
 }
 
 
-CvPtVector_t slSkel::getRawPoints(const slContours::const_iterator &contour, const cv::Rect &rect) const
+slContourView slSkel::approximate(const slContourView &contour, double distance,
+								  slSkelScratch &scratch) const
+{
+	slContourEngine::approximate(contour, distance, scratch.approx);
+
+	return slContourView(scratch.approx);
+}
+
+
+void slSkel::fillContour(const slContourView &contour, const cv::Scalar &color,
+						 slSkelScratch &scratch) const
+{
+	// Same as drawContours() with CV_FILLED for a single contour
+	const Point *pts = contour.begin();
+	const int nbPts = (int)contour.size();
+
+	if (nbPts > 0) fillPoly(scratch.imBlob, &pts, &nbPts, 1, color, 8, 0, -scratch.origin);
+}
+
+
+CvPtVector_t slSkel::getRawPoints(const slSkelScratch &scratch) const
 {
 	CvPtVector_t rawPts;
 
-	// For each pixel of the ROI
-	for (int row = rect.y; row < rect.y + rect.height; row++) {
-		const float *rowPtr = imSkel_[row];
+	// For each pixel of the blob's images
+	for (int row = 0; row < scratch.imSkel.rows; row++) {
+		const float *rowPtr = scratch.imSkel[row];
 
-		for (int col = rect.x; col < rect.x + rect.width; col++) {
-			// If it is a significant peak
+		for (int col = 0; col < scratch.imSkel.cols; col++) {
+			// If it is a significant peak, position in the frame
 			if (rowPtr[col] >= peekThreshold_) {
-				rawPts.push_back(cvPoint(col, row));
+				rawPts.push_back(cvPoint(col + scratch.origin.x, row + scratch.origin.y));
 			}
 		}
 	}
@@ -453,67 +1050,227 @@ CvPtVector_t slSkel::getRawPoints(const slContours::const_iterator &contour, con
 }
 
 
-unsigned int* slSkel::createDistMat(const CvPtVector_t &rawPts) const
+// Binary heap of the children, by distance to the tree then by index.
+// A child is at most once in the heap: its key only decreases (decrease-key).
+class slSkelHeap
 {
-	const unsigned int N = rawPts.size();
-	unsigned int *dists = new unsigned int[N * N];
+public:
+	slSkelHeap(const vector<unsigned int> &distTree)
+	: key_(distTree), pos_(distTree.size(), UINT_MAX)
+	{ items_.reserve(distTree.size()); }
 
-	// Square of distance between all points
-	for (unsigned int row = 0; row < N; row++) {
-		for (unsigned int col = 0; col < N; col++) {
-			int diffX = rawPts[row].x - rawPts[col].x;
-			int diffY = rawPts[row].y - rawPts[col].y;
+	bool empty() const { return items_.empty(); }
+	unsigned int top() const { return items_[0]; }
 
-			dists[row * N + col] = (unsigned int)(diffX * diffX + diffY * diffY);
+	// Inserts the child, or moves it up after its key decreased
+	void update(unsigned int child)
+	{
+		if (pos_[child] == UINT_MAX) {
+			pos_[child] = (unsigned int)items_.size();
+			items_.push_back(child);
 		}
+
+		siftUp(pos_[child]);
 	}
 
-	return dists;
-}
+	void pop()
+	{
+		pos_[items_[0]] = UINT_MAX;
+		items_[0] = items_.back();
+		items_.pop_back();
+
+		if (!items_.empty()) {
+			pos_[items_[0]] = 0;
+			siftDown(0);
+		}
+	}
+
+private:
+	bool less(unsigned int a, unsigned int b) const
+	{ return (key_[a] < key_[b] || (key_[a] == key_[b] && a < b)); }
 
+	void place(unsigned int ind, unsigned int child)
+	{
+		items_[ind] = child;
+		pos_[child] = ind;
+	}
+
+	void siftUp(unsigned int ind)
+	{
+		const unsigned int child = items_[ind];
+
+		while (ind > 0 && less(child, items_[(ind - 1) / 2])) {
+			place(ind, items_[(ind - 1) / 2]);
+			ind = (ind - 1) / 2;
+		}
+
+		place(ind, child);
+	}
+
+	void siftDown(unsigned int ind)
+	{
+		const unsigned int child = items_[ind];
+		const unsigned int size = (unsigned int)items_.size();
+
+		while (2 * ind + 1 < size) {
+			unsigned int next = 2 * ind + 1;
+
+			if (next + 1 < size && less(items_[next + 1], items_[next])) next++;
+			if (!less(items_[next], child)) break;
 
-void slSkel::computeParents(UIntVector_t &parents, const unsigned int *dists, unsigned int distInf) const
+			place(ind, items_[next]);
+			ind = next;
+		}
+
+		place(ind, child);
+	}
+
+private:
+	const vector<unsigned int> &key_;
+	vector<unsigned int> items_, pos_;
+};
+
+
+void slSkel::computeParents(const CvPtVector_t &rawPts, const cv::Rect &rect, UIntVector_t &parents) const
 {
-	const unsigned int N = parents.size();
-	UIntVector_t distTree(N + 1, distInf);
-	vector<bool> inTree(N, false);
-	unsigned int parent = 0;
+	const unsigned int N = rawPts.size();
+	const unsigned int maxDist = SKEL_GRID_CELL * SKEL_GRID_CELL;
+	if (N == 0) return;
+
+	// Sort the points by grid cell, so the points near a point are found quickly
+	const int gridWidth = rect.width / SKEL_GRID_CELL + 1;
+	const int gridHeight = rect.height / SKEL_GRID_CELL + 1;
+	UIntVector_t cellStart(gridWidth * gridHeight + 1, 0), cellPoints(N), cellOf(N);
+
+	for (unsigned int ind = 0; ind < N; ind++) {
+		cellOf[ind] = ((rawPts[ind].y - rect.y) / SKEL_GRID_CELL) * gridWidth + (rawPts[ind].x - rect.x) / SKEL_GRID_CELL;
+		cellStart[cellOf[ind] + 1]++;
+	}
 
-	// While not end of parents
-	while (parent < N) {
+	for (size_t cell = 1; cell < cellStart.size(); cell++) {
+		cellStart[cell] += cellStart[cell - 1];
+	}
+
+	UIntVector_t cellEnd(cellStart.begin(), cellStart.end() - 1);
+
+	for (unsigned int ind = 0; ind < N; ind++) {
+		cellPoints[cellEnd[cellOf[ind]]++] = ind;
+	}
+
+	// Prim's algorithm with a heap, same choices as with the complete graph
+	UIntVector_t distTree(N, UINT_MAX);
+	UIntVector_t order(N, UINT_MAX);		// Rank of each point in the tree, UINT_MAX if not in tree
+	slSkelHeap heap(distTree);
+	unsigned int parent = 0, nbTree = 0, nbSearched = 0;	// Ranks [0, nbSearched[ were compared with all points
+	Point newMin(INT_MAX, INT_MAX), newMax(INT_MIN, INT_MIN);	// Bounding box of the other tree points
+
+	while (true) {
 		// Add current parent in tree
-		inTree[parent] = true;
-
-		// Set nextParent NULL
-		int nextParent = N;
-
-		// For each child (we know 0 is always a parent)
-		for (unsigned int child = 1; child < N; child++) {
-			// If the child is not in tree
-			if (!inTree[child]) {
-				// If distance between the parent and the child is less than
-				// the known distance between the tree and the child
-				if (distTree[child] > dists[parent * N + child]) {
-					distTree[child] = dists[parent * N + child];
-					parents[child] = parent;	// Save potential parent for child
+		order[parent] = nbTree++;
+		newMin.x = min(newMin.x, rawPts[parent].x); newMax.x = max(newMax.x, rawPts[parent].x);
+		newMin.y = min(newMin.y, rawPts[parent].y); newMax.y = max(newMax.y, rawPts[parent].y);
+
+		if (nbTree == N) break;
+
+		// Only the children in the cells around the parent, at most one cell away
+		const int cellX = cellOf[parent] % gridWidth, cellY = cellOf[parent] / gridWidth;
+
+		for (int y = max(cellY - 1, 0); y <= min(cellY + 1, gridHeight - 1); y++) {
+			for (int x = max(cellX - 1, 0); x <= min(cellX + 1, gridWidth - 1); x++) {
+				for (unsigned int ind = cellStart[y * gridWidth + x]; ind < cellStart[y * gridWidth + x + 1]; ind++) {
+					const unsigned int child = cellPoints[ind];
+					int diffX = rawPts[parent].x - rawPts[child].x;
+					int diffY = rawPts[parent].y - rawPts[child].y;
+					unsigned int dist = (unsigned int)(diffX * diffX + diffY * diffY);
+
+					// Only the distances under one cell are always found
+					if (order[child] == UINT_MAX && dist <= maxDist && distTree[child] > dist) {
+						distTree[child] = dist;
+						parents[child] = parent;	// Save potential parent for child
+						heap.update(child);
+					}
+				}
+			}
+		}
+
+		// Under one cell, the distance to the tree is exact.  Otherwise, each
+		// child looks for the tree points not compared yet in rings of cells
+		// around it, inside their bounding box, until a ring is farther than
+		// its distance to the tree.
+		if (heap.empty() || distTree[heap.top()] > maxDist) {
+			const int boxX1 = (newMin.x - rect.x) / SKEL_GRID_CELL, boxX2 = (newMax.x - rect.x) / SKEL_GRID_CELL;
+			const int boxY1 = (newMin.y - rect.y) / SKEL_GRID_CELL, boxY2 = (newMax.y - rect.y) / SKEL_GRID_CELL;
+
+			for (unsigned int child = 1; child < N; child++) {
+				if (order[child] != UINT_MAX) continue;
+
+				const Point &pt = rawPts[child];
+				unsigned int dist = distTree[child], nearest = parents[child];
+
+				// Skip the child if the bounding box is too far
+				int boxDiffX = max(0, max(newMin.x - pt.x, pt.x - newMax.x));
+				int boxDiffY = max(0, max(newMin.y - pt.y, pt.y - newMax.y));
+				if ((unsigned int)(boxDiffX * boxDiffX + boxDiffY * boxDiffY) > dist) continue;
+
+				const int childX = cellOf[child] % gridWidth, childY = cellOf[child] / gridWidth;
+				const int firstRing = max(max(boxX1 - childX, childX - boxX2), max(boxY1 - childY, childY - boxY2));
+				const int lastRing = max(max(childX - boxX1, boxX2 - childX), max(childY - boxY1, boxY2 - childY));
+
+				for (int ring = max(firstRing, 0); ring <= lastRing; ring++) {
+					// Nearest possible point of the ring
+					const unsigned int gap = (ring > 0 ? (ring - 1) * SKEL_GRID_CELL + 1 : 0);
+					if (gap * gap > dist) break;
+
+					for (int y = max(childY - ring, boxY1); y <= min(childY + ring, boxY2); y++) {
+						// Inside the ring, only its left and right cells
+						const int step = (y == childY - ring || y == childY + ring ? 1 : 2 * ring);
+
+						for (int x = childX - ring; x <= childX + ring; x += step) {
+							if (x < boxX1 || x > boxX2) continue;
+
+							for (unsigned int ind = cellStart[y * gridWidth + x]; ind < cellStart[y * gridWidth + x + 1]; ind++) {
+								const unsigned int point = cellPoints[ind];
+								if (order[point] == UINT_MAX || order[point] < nbSearched) continue;
+
+								int diffX = rawPts[point].x - pt.x;
+								int diffY = rawPts[point].y - pt.y;
+								unsigned int distPoint = (unsigned int)(diffX * diffX + diffY * diffY);
+
+								// On a tie, the first point added to the tree is the parent
+								if (distPoint < dist || (distPoint == dist && order[point] < order[nearest])) {
+									dist = distPoint;
+									nearest = point;
+								}
+							}
+						}
+					}
 				}
 
-				// Keep closest child to the tree
-				if (distTree[nextParent] > distTree[child]) {
-					nextParent = child;
+				if (dist < distTree[child]) {
+					distTree[child] = dist;
+					heap.update(child);
 				}
+
+				parents[child] = nearest;
 			}
+
+			nbSearched = nbTree;
+			newMin = Point(INT_MAX, INT_MAX);
+			newMax = Point(INT_MIN, INT_MIN);
 		}
 
-		parent = nextParent;
+		// Keep closest child to the tree
+		parent = heap.top();
+		heap.pop();
 	}
 }
 
 
-slKeyPoints slSkel::computeKeyPoints(const CvPtVector_t &rawPts, UIntVector_t &parents) const
+void slSkel::computeKeyPoints(const CvPtVector_t &rawPts, UIntVector_t &parents,
+							  const slSkelScratch &scratch, slKeyPointGraph &graph) const
 {
 	const unsigned int N = rawPts.size();
-	if (N < 2) return slKeyPoints();
+	if (N < 2) return;
 
 	// Compute the number of neighbors for all points
 	UIntVector_t nbNeighbors(N, 0);
@@ -547,45 +1304,45 @@ slKeyPoints slSkel::computeKeyPoints(const CvPtVector_t &rawPts, UIntVector_t &p
 	greatestParent = keyPtInd;
 
 	// Save keypoints and their neighbors
-	slKeyPoints keyPoints;
+	vector<int> vertices(N, -1);
 
 	for (unsigned int ind = 0; ind < N; ind++) {
 		// If it is a keypoint
 		if (nbNeighbors[ind] != 2) {
 			Point pt = rawPts[ind];
-			Point2f position(pt);
-			slKeyPoint &keyPoint = keyPoints[position];
 
 			// Save its descriptors
-			keyPoint.moveTo(position);
-			keyPoint.insert(new slSkelRelDist(imDist_[pt.y][pt.x]));
+			vertices[ind] = graph.addVertex(Point2f(pt));
+			graph.setRelDist(vertices[ind], scratch.imDist[pt.y - scratch.origin.y][pt.x - scratch.origin.x]);
 		}
 	}
 
 	for (unsigned int ind = 0; ind < N; ind++) {
 		// If it is a keypoint, but not the greatest parent
 		if (nbNeighbors[ind] != 2 && ind != greatestParent) {
-			Point2f pt(rawPts[ind]), neighborPt;
 			unsigned int neighborInd = parents[ind];
 
 			while (nbNeighbors[neighborInd] == 2) {
 				neighborInd = parents[neighborInd];
 			}
 
-			neighborPt = rawPts[neighborInd];
-
 			// Link the keypoint to its parent (neighbors)
-			keyPoints[pt].insert(neighborPt);
-			keyPoints[neighborPt].insert(pt);
+			graph.addNeighbor(vertices[ind], vertices[neighborInd]);
+			graph.addNeighbor(vertices[neighborInd], vertices[ind]);
 		}
 	}
-
-	return keyPoints;
 }
 
 
 float slSkel::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 							   float diagLength, int offsetX, int offsetY) const
+{
+	return scoreKeyPoints(kPt1, kPt2, diagLength, offsetX, offsetY);
+}
+
+
+float slSkel::scoreKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
+							 float diagLength, int offsetX, int offsetY)
 {
 	float score = 0;
 
@@ -593,8 +1350,9 @@ float slSkel::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 	score += kPt1.scoreOrientation(kPt2);
 	score += kPt1.scoreNbNeighbors(kPt2);
 
-	const slSkelRelDist *rd1 = dynamic_cast<const slSkelRelDist*>(kPt1.find(DESC_RELDIST));
-	const slSkelRelDist *rd2 = dynamic_cast<const slSkelRelDist*>(kPt2.find(DESC_RELDIST));
+	// Typed slots, no search by name
+	const slSkelRelDist *rd1 = kPt1.getRelDist();
+	const slSkelRelDist *rd2 = kPt2.getRelDist();
 
 	if (rd1 != NULL && rd2 != NULL) score += rd1->scoreRelDist(*rd2);
 
@@ -602,6 +1360,12 @@ float slSkel::compareKeyPoints(const slKeyPoint &kPt1, const slKeyPoint &kPt2,
 }
 
 
+int slSkel::getScoreTerms() const
+{
+	return SCORE_EUCLIDEAN | SCORE_ORIENTATION | SCORE_NBNEIGHBORS | SCORE_RELDIST;
+}
+
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //	slBlobAnalyzerFactory
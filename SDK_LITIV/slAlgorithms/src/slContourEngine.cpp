@@ -3,6 +3,7 @@
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <iostream>
+#include <string.h>
 
 
 using namespace cv;
@@ -11,10 +12,12 @@ using namespace slAH;
 
 
 #define ARG_CLOSURE "-c"
+#define ARG_CLOSURE_RECT "-cr"
+#define ARG_INCREMENTAL "-ci"
 
 
 slContourEngine::slContourEngine()
-:doClosure_(false)
+:doClosure_(false), rectKernel_(false), incremental_(false), tileSize_(32)
 {
 }
 
@@ -29,7 +32,9 @@ slContourEngine::~slContourEngine()
 void slContourEngine::fillParamSpecs(slAH::slParamSpecMap& paramSpecMap)
 {
 	paramSpecMap << (slParamSpec(ARG_CLOSURE, "Do closure with kernel size w*k")
-		<< slSyntax("w", "3") << slSyntax("h", "3"));
+		<< slSyntax("w", "3") << slSyntax("h", "3"))
+		<< slParamSpec(ARG_CLOSURE_RECT, "Use a rectangular kernel for the closure")
+		<< (slParamSpec(ARG_INCREMENTAL, "Trace again only the changed tiles") << slSyntax("tile", "32"));
 }
 
 
@@ -39,21 +44,49 @@ void slContourEngine::setParameters(const slAH::slParameters& parameters)
 	if (parameters.isParsed(ARG_CLOSURE)) {
 		setClosure(true,
 			atoi(parameters.getValue(ARG_CLOSURE, 0).c_str()), 
-			atoi(parameters.getValue(ARG_CLOSURE, 1).c_str()));
+			atoi(parameters.getValue(ARG_CLOSURE, 1).c_str()),
+			parameters.isParsed(ARG_CLOSURE_RECT));
 	}
 	else {
 		setClosure(false);
 	}
+
+	// Incremental contours
+	if (parameters.isParsed(ARG_INCREMENTAL)) {
+		setIncremental(true, atoi(parameters.getValue(ARG_INCREMENTAL).c_str()));
+	}
+	else {
+		setIncremental(false);
+	}
 }
 
 
-void slContourEngine::setClosure(bool enabled, int w, int h)
+void slContourEngine::setClosure(bool enabled, int w, int h, bool rect)
 {
 	kernel_.release();
+	rectKernel_ = rect;
 
 	if (doClosure_ = enabled) {
-		kernel_ = getStructuringElement(MORPH_ELLIPSE, Size(w, h));
+		kernel_ = getStructuringElement(rect ? MORPH_RECT : MORPH_ELLIPSE, Size(w, h));
+		morphology_.setKernel(kernel_);
 	}
+
+	// The previous contours were found with another closure
+	previous_.release();
+	contours_.clear();
+}
+
+
+void slContourEngine::setIncremental(bool enabled, int tileSize)
+{
+	if (tileSize < 1) {
+		throw slException("slContourEngine::setIncremental(): the tile size must be positive");
+	}
+
+	incremental_ = enabled;
+	tileSize_ = tileSize;
+
+	previous_.release();
 }
 
 
@@ -63,7 +96,17 @@ void slContourEngine::showParameters() const
 
 	cout << "Closure : ";
 	if (doClosure_) {
-		cout << "Yes, " << kernel_.size().width << "x" << kernel_.size().height << endl;
+		cout << "Yes, " << kernel_.size().width << "x" << kernel_.size().height
+			<< (rectKernel_ ? " rectangle" : " ellipse")
+			<< (morphology_.isSeparable() ? " (van Herk/Gil-Werman)" : " (run-length)") << endl;
+	}
+	else {
+		cout << "No" << endl;
+	}
+
+	cout << "Incremental : ";
+	if (incremental_) {
+		cout << "Yes, tiles of " << tileSize_ << "x" << tileSize_ << endl;
 	}
 	else {
 		cout << "No" << endl;
@@ -75,32 +118,91 @@ void slContourEngine::showParameters() const
 
 void slContourEngine::findContours(slImage1ch &bForeground)
 {
-	if (doClosure_) {
-		morphologyEx(bForeground, bForeground, MORPH_CLOSE, kernel_);
+	if (incremental_) {
+		// Compare with the previous foreground, before the closure
+		findDirtyTiles(previous_, bForeground, tileSize_, dirtyRects_);
+		bForeground.copyTo(previous_);
+
+		findContours(bForeground, dirtyRects_);
 	}
+	else {
+		if (doClosure_) {
+			morphology_.close(bForeground);
+		}
 
-	// Find all contours
-	contours_.findAll(bForeground);
+		// Find all contours
+		contours_.findAll(bForeground);
+	}
 }
 
 
-slContour slContourEngine::approximate(const slContour &contour, double distance)
+void slContourEngine::findContours(slImage1ch &bForeground, const std::vector<cv::Rect> &dirtyRects)
 {
-	slContour approx;
+	if (doClosure_) {
+		morphology_.close(bForeground);
 
-	if (!contour.empty()) {
-		CvPt2fVector_t approx2f;
+		// The closure moves the changes by up to the kernel size
+		const Size size = kernel_.size();
+
+		for (vector<Rect>::const_iterator it = dirtyRects.begin(); it != dirtyRects.end(); it++) {
+			grownRects_.push_back(Rect(it->x - size.width, it->y - size.height,
+				it->width + 2 * size.width, it->height + 2 * size.height));
+		}
+
+		contours_.update(bForeground, grownRects_);
+		grownRects_.clear();
+	}
+	else {
+		contours_.update(bForeground, dirtyRects);
+	}
+}
+
+
+void slContourEngine::findDirtyTiles(const slImage1ch &previous, const slImage1ch &current,
+									 int tileSize, std::vector<cv::Rect> &dirtyRects)
+{
+	dirtyRects.clear();
+
+	// Everything changed
+	if (previous.size() != current.size()) {
+		dirtyRects.push_back(Rect(Point(), current.size()));
+		return;
+	}
 
-		// Approximate contour
-		approxPolyDP(contour, approx2f, distance, true);
+	for (int y = 0; y < current.rows; y += tileSize) {
+		const int height = min(tileSize, current.rows - y);
 
-		// Conversion Point2f->Point
-		for (CvPt2fVector_t::const_iterator it = approx2f.begin(); it != approx2f.end(); it++) {
-			approx.push_back(*it);
+		for (int x = 0; x < current.cols; x += tileSize) {
+			const int width = min(tileSize, current.cols - x);
+
+			// Compare the rows of the tile
+			for (int row = y; row < y + height; row++) {
+				if (memcmp(previous[row] + x, current[row] + x, width) != 0) {
+					dirtyRects.push_back(Rect(x, y, width, height));
+					break;
+				}
+			}
 		}
 	}
+}
+
+
+slContour slContourEngine::approximate(const slContourView &contour, double distance)
+{
+	slContour approx;
+
+	approximate(contour, distance, approx);
 
 	return approx;
 }
 
 
+void slContourEngine::approximate(const slContourView &contour, double distance, slContour &approx)
+{
+	approx.clear();
+
+	if (!contour.empty()) {
+		// Approximate contour, integer points in, integer points out
+		approxPolyDP(contour.mat(), approx, distance, true);
+	}
+}
@@ -0,0 +1,299 @@
+#include "slDceHierarchy.h"
+
+#include <algorithm>
+#include <limits>
+
+
+using namespace cv;
+using namespace std;
+
+
+#define DCE_MIN_POINTS 3	// The evolution stops at a triangle
+
+
+// Indexed binary min-heap of the points' K values, so the least significant
+// point is found in O(log N) instead of scanning the whole list.  The
+// arrays belong to the hierarchy, so they keep their memory between calls.
+class DceHeap
+{
+public:
+	DceHeap(const float *k, vector<int> &heap, vector<int> &pos, int size)
+	: k_(k), heap_(heap), pos_(pos)
+	{
+		heap_.resize(size);
+		pos_.resize(size);
+
+		for (int ind = 0; ind < size; ind++) {
+			heap_[ind] = pos_[ind] = ind;
+		}
+
+		for (int ind = size / 2 - 1; ind >= 0; ind--) {
+			siftDown(ind);
+		}
+	}
+
+	int top() const { return heap_.front(); }
+
+	void remove(int index)
+	{
+		const int pos = pos_[index];
+		const int last = heap_.back();
+
+		heap_.pop_back();
+
+		if (last != index) {
+			heap_[pos] = last;
+			pos_[last] = pos;
+			update(last);
+		}
+	}
+
+	void update(int index)
+	{
+		siftUp(pos_[index]);
+		siftDown(pos_[index]);
+	}
+
+private:
+	// Same order as the linear search: smallest K first, then smallest index.
+	// NaN never wins a strict comparison, so it goes after everything.
+	bool less(int a, int b) const
+	{
+		const float kA = k_[a], kB = k_[b];
+
+		if (kB != kB) return (kA == kA || a < b);
+		if (kA != kA) return false;
+
+		return (kA < kB || (kA == kB && a < b));
+	}
+
+	void place(int pos, int index)
+	{
+		heap_[pos] = index;
+		pos_[index] = pos;
+	}
+
+	void siftUp(int pos)
+	{
+		const int index = heap_[pos];
+
+		while (pos > 0 && less(index, heap_[(pos - 1) / 2])) {
+			place(pos, heap_[(pos - 1) / 2]);
+			pos = (pos - 1) / 2;
+		}
+
+		place(pos, index);
+	}
+
+	void siftDown(int pos)
+	{
+		const int index = heap_[pos];
+		const int size = (int)heap_.size();
+
+		for (int child = 2 * pos + 1; child < size; child = 2 * pos + 1) {
+			if (child + 1 < size && less(heap_[child + 1], heap_[child])) child++;
+			if (!less(heap_[child], index)) break;
+
+			place(pos, heap_[child]);
+			pos = child;
+		}
+
+		place(pos, index);
+	}
+
+private:
+	const float *k_;		// K value of each point
+	vector<int> &heap_;		// Heap of point indexes
+	vector<int> &pos_;		// Position of each point in heap_
+
+};
+
+
+slDceHierarchy::slDceHierarchy()
+{
+}
+
+
+slDceHierarchy::~slDceHierarchy()
+{
+}
+
+
+void slDceHierarchy::compute(const slContourView &contour)
+{
+	points_.assign(contour.begin(), contour.end());
+	removed_.clear();
+	left_.clear();
+	right_.clear();
+	removedK_.clear();
+	maxK_.clear();
+	last_.clear();
+
+	if (points_.empty()) return;
+
+	// Circular double-linked list of point indexes, in prev_ and next_
+	// (getPolygon() rebuilds them), with the K value of each point
+	int totalPt = (int)points_.size();
+	prev_.resize(totalPt);
+	next_.resize(totalPt);
+	k_.resize(totalPt);
+
+	for (int ind = 0; ind < totalPt; ind++) {
+		prev_[ind] = (ind > 0 ? ind - 1 : totalPt - 1);
+		next_[ind] = (ind < totalPt - 1 ? ind + 1 : 0);
+	}
+
+	// Compute K for each point
+	for (int ind = 0; ind < totalPt; ind++) {
+		k_[ind] = slDceK::compute(points_[prev_[ind]], points_[ind], points_[next_[ind]]);
+	}
+
+	DceHeap heap(&k_[0], heap_, heapPos_, totalPt);
+	float maxK = -numeric_limits<float>::infinity();
+	int head = 0;
+
+	// Loop until the polygon is a triangle
+	while (totalPt > DCE_MIN_POINTS) {
+		// Find the least significant point.  The search used to start from
+		// head, so a NaN on head is the only value taken before the heap's top.
+		const int ptMin = (k_[head] != k_[head] ? head : heap.top());
+		const int left = prev_[ptMin], right = next_[ptMin];
+
+		// Record the removal
+		removed_.push_back(ptMin);
+		left_.push_back(left);
+		right_.push_back(right);
+		removedK_.push_back(k_[ptMin]);
+
+		maxK = max(maxK, k_[ptMin] != k_[ptMin] ? numeric_limits<float>::infinity() : k_[ptMin]);
+		maxK_.push_back(maxK);
+
+		// Delete the least significant point
+		totalPt--;
+		if (head == ptMin) head = right;
+		heap.remove(ptMin);
+
+		// Join the neighbors together
+		next_[left] = right;
+		prev_[right] = left;
+
+		// Update neighbors' K value, one at a time for the heap
+		k_[left] = slDceK::compute(points_[prev_[left]], points_[left], points_[right]);
+		heap.update(left);
+
+		k_[right] = slDceK::compute(points_[left], points_[right], points_[next_[right]]);
+		heap.update(right);
+	}
+
+	// Remaining points, from head
+	for (int ind = 0; ind < totalPt; ind++) {
+		last_.push_back(head);
+		head = next_[head];
+	}
+}
+
+
+int slDceHierarchy::getMinNumOfPoints() const
+{
+	return (int)last_.size();
+}
+
+
+int slDceHierarchy::getNumOfPoints(float kThreshold) const
+{
+	// The running maximum is sorted: all removals before it reaches kThreshold
+	const int nbRemoved = (int)(lower_bound(maxK_.begin(), maxK_.end(), kThreshold) - maxK_.begin());
+
+	return size() - nbRemoved;
+}
+
+
+void slDceHierarchy::getPolygon(int nbPoints, std::vector<int> &indexes) const
+{
+	const int nbLast = (int)last_.size();
+
+	nbPoints = max(nbLast, min(nbPoints, size()));
+	indexes.resize(nbPoints);
+
+	if (nbPoints == 0) return;
+
+	// Last points of the evolution
+	int start = last_.front();
+
+	for (int ind = 0; ind < nbLast; ind++) {
+		next_[last_[ind]] = last_[(ind + 1) % nbLast];
+		prev_[last_[(ind + 1) % nbLast]] = last_[ind];
+		start = min(start, last_[ind]);
+	}
+
+	// Put back the removed points, last removed first
+	for (int step = size() - nbLast - 1; step >= size() - nbPoints; step--) {
+		const int pt = removed_[step];
+
+		next_[left_[step]] = prev_[right_[step]] = pt;
+		prev_[pt] = left_[step];
+		next_[pt] = right_[step];
+		start = min(start, pt);
+	}
+
+	// In contour order, from the smallest index
+	for (int ind = 0, pt = start; ind < nbPoints; ind++, pt = next_[pt]) {
+		indexes[ind] = pt;
+	}
+}
+
+
+void slDceHierarchy::getPolygon(int nbPoints, std::vector<slDceVertex> &vertices) const
+{
+	getPolygon(nbPoints, polygon_);
+
+	const int total = (int)polygon_.size();
+	vertices.resize(total);
+
+	for (int ind = 0; ind < total; ind++) {
+		const Point &left = points_[polygon_[(ind + total - 1) % total]];
+		const Point &pt = points_[polygon_[ind]];
+		const Point &right = points_[polygon_[(ind + 1) % total]];
+
+		vertices[ind].position = pt;
+		vertices[ind].index = polygon_[ind];
+		vertices[ind].k = slDceK::compute(left, pt, right, vertices[ind].turn);
+	}
+}
+
+
+slKeyPoints slDceHierarchy::getKeyPoints(int nbPoints) const
+{
+	slKeyPointGraph graph;
+
+	graph.beginBlob();
+	getKeyPoints(nbPoints, graph);
+	graph.endBlob();
+
+	return graph.getKeyPoints(0);
+}
+
+
+void slDceHierarchy::getKeyPoints(int nbPoints, slKeyPointGraph &graph) const
+{
+	getPolygon(nbPoints, polygon_);
+
+	// Add remaining points, they are vertices first..first + total - 1
+	const int total = (int)polygon_.size();
+	const int first = (total > 0 ? graph.addVertex(points_[polygon_[0]]) : 0);
+
+	for (int ind = 1; ind < total; ind++) {
+		graph.addVertex(points_[polygon_[ind]]);
+	}
+
+	for (int ind = 0; ind < total; ind++) {
+		const int left = (ind + total - 1) % total;
+		const int right = (ind + 1) % total;
+
+		// Save its descriptors
+		graph.setK(first + ind, slDceK::compute(
+			points_[polygon_[left]], points_[polygon_[ind]], points_[polygon_[right]]));
+		graph.addNeighbor(first + ind, first + left);
+		graph.addNeighbor(first + ind, first + right);
+	}
+}
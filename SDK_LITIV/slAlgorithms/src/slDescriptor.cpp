@@ -50,12 +50,20 @@ float slDceK::scoreK(const slDceK &k2) const
 
 
 float slDceK::compute(const cv::Point &p0, const cv::Point &p1, const cv::Point &p2)
+{
+	float beta;
+
+	return compute(p0, p1, p2, beta);
+}
+
+
+float slDceK::compute(const cv::Point &p0, const cv::Point &p1, const cv::Point &p2, float &beta)
 {
 	CvPoint vect1 = cvPoint(p1.x - p0.x, p1.y - p0.y);
 	CvPoint vect2 = cvPoint(p2.x - p1.x, p2.y - p1.y);
 	float long1 = sqrt((float)vect1.x * vect1.x + vect1.y * vect1.y);
 	float long2 = sqrt((float)vect2.x * vect2.x + vect2.y * vect2.y);
-	float beta = acos(((float)vect1.x * vect2.x + vect1.y * vect2.y) / (long1 * long2));
+	beta = acos(((float)vect1.x * vect2.x + vect1.y * vect2.y) / (long1 * long2));
 
 	return (beta * long1 * long2 / (long1 + long2));
 }
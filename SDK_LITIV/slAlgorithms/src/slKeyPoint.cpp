@@ -11,11 +11,13 @@ using namespace std;
 
 
 slKeyPoint::slKeyPoint()
+: slots_(0)
 {
 }
 
 
 slKeyPoint::slKeyPoint(const slKeyPoint &kPt)
+: slots_(0)
 {
 	*this = kPt;
 }
@@ -36,6 +38,7 @@ void slKeyPoint::clearDescriptors()
 	}
 
 	descriptors_.clear();
+	slots_ = 0;
 }
 
 
@@ -46,6 +49,11 @@ const slKeyPoint& slKeyPoint::operator=(const slKeyPoint &kPt)
 		neighbors_ = kPt.neighbors_;
 		clearDescriptors();
 
+		// Typed slots are copied, not cloned
+		slots_ = kPt.slots_;
+		k_ = kPt.k_;
+		relDist_ = kPt.relDist_;
+
 		for (map<string, slDescriptor*>::const_iterator it = kPt.descriptors_.begin();
 			it != kPt.descriptors_.end(); it++)
 		{
@@ -95,6 +103,9 @@ CvPt2fVector_t::const_iterator slKeyPoint::endNeighbors() const
 
 const slDescriptor* slKeyPoint::find(const std::string &name) const
 {
+	if (name == DESC_K) return getK();
+	if (name == DESC_RELDIST) return getRelDist();
+
 	map<string, slDescriptor*>::const_iterator it = descriptors_.find(name);
 
 	return (it != descriptors_.end() ? it->second : NULL);
@@ -105,13 +116,43 @@ void slKeyPoint::insert(slDescriptor *desc)
 {
 	string name(desc->getName());
 
+	// Known descriptors go in their slot
+	if (name == DESC_K) {
+		insert(*static_cast<slDceK*>(desc));
+		delete desc;
+		return;
+	}
+
+	if (name == DESC_RELDIST) {
+		insert(*static_cast<slSkelRelDist*>(desc));
+		delete desc;
+		return;
+	}
+
 	remove(name);
 	descriptors_[name] = desc;
 }
 
 
+void slKeyPoint::insert(const slDceK &k)
+{
+	k_ = k;
+	slots_ |= KEYPT_K;
+}
+
+
+void slKeyPoint::insert(const slSkelRelDist &relDist)
+{
+	relDist_ = relDist;
+	slots_ |= KEYPT_RELDIST;
+}
+
+
 void slKeyPoint::remove(const std::string &name)
 {
+	if (name == DESC_K) slots_ &= ~KEYPT_K;
+	if (name == DESC_RELDIST) slots_ &= ~KEYPT_RELDIST;
+
 	map<string, slDescriptor*>::iterator it = descriptors_.find(name);
 
 	if (it != descriptors_.end()) {
@@ -130,29 +171,40 @@ float slKeyPoint::scoreEuclidean(const slKeyPoint &kPt2, float diagLength, int o
 }
 
 
+// cos(Theta) between the vectors pt1->ne1 and pt2->ne2
+static inline float cosTheta(const Point2f &pt1, const Point2f &ne1, const Point2f &pt2, const Point2f &ne2)
+{
+	float ax = ne1.x - pt1.x;
+	float ay = ne1.y - pt1.y;
+	float bx = ne2.x - pt2.x;
+	float by = ne2.y - pt2.y;
+
+	return (ax * bx + ay * by) / sqrt((ax * ax + ay * ay) * (bx * bx + by * by));
+}
+
+
 float slKeyPoint::scoreOrientation(const slKeyPoint &kPt2) const
 {
 	const slKeyPoint &kPt1 = *this;
-	const CvPoint2D32f pt1 = kPt1.position_;
-	const CvPoint2D32f pt2 = kPt2.position_;
+	const Point2f &pt1 = kPt1.position_;
+	const Point2f &pt2 = kPt2.position_;
 	const unsigned int nb1 = kPt1.neighbors_.size();
 	const unsigned int nb2 = kPt2.neighbors_.size();
-	float *cosTheta = new float[nb1 * nb2];
-
-	// Compute all possible cos(Theta)
-	for (unsigned int ind1 = 0; ind1 < nb1; ind1++) {
-		CvPoint2D32f ne1 = kPt1.neighbors_[ind1];
 
-		for (unsigned int ind2 = 0; ind2 < nb2; ind2++) {
-			CvPoint2D32f ne2 = kPt2.neighbors_[ind2];
+	// No neighbor, no orientation (same as slKeyPointScorer)
+	if (nb1 == 0 || nb2 == 0) return 0;
 
-			float ax = ne1.x - pt1.x;
-			float ay = ne1.y - pt1.y;
-			float bx = ne2.x - pt2.x;
-			float by = ne2.y - pt2.y;
+	// Key points rarely have more than 4 neighbors: all possible cos(Theta)
+	// fit on the stack.  Otherwise, they are computed when needed, so no
+	// call allocates memory.
+	float buffer[KEYPT_ORIENTATION_BUFFER];
+	const bool table = (nb1 * nb2 <= KEYPT_ORIENTATION_BUFFER);
 
-			cosTheta[ind1 * nb2 + ind2] = (ax * bx + ay * by) /
-				sqrt((ax * ax + ay * ay) * (bx * bx + by * by));
+	if (table) {
+		for (unsigned int ind1 = 0; ind1 < nb1; ind1++) {
+			for (unsigned int ind2 = 0; ind2 < nb2; ind2++) {
+				buffer[ind1 * nb2 + ind2] = cosTheta(pt1, kPt1.neighbors_[ind1], pt2, kPt2.neighbors_[ind2]);
+			}
 		}
 	}
 
@@ -160,28 +212,38 @@ float slKeyPoint::scoreOrientation(const slKeyPoint &kPt2) const
 
 	// For each neighbor of point 1
 	for (unsigned int ind1 = 0; ind1 < nb1; ind1++) {
-		float *row = &cosTheta[ind1 * nb2];
+		const Point2f &ne1 = kPt1.neighbors_[ind1];
 		int ind2Max = 0;
+		float rowMax = (table ? buffer[ind1 * nb2] : cosTheta(pt1, ne1, pt2, kPt2.neighbors_[0]));
 
 		// Find the neighbor of point 2 that gives a similar orientation
 		for (unsigned int ind2 = 1; ind2 < nb2; ind2++) {
-			if (row[ind2] > row[ind2Max]) ind2Max = ind2;
+			float c = (table ? buffer[ind1 * nb2 + ind2] : cosTheta(pt1, ne1, pt2, kPt2.neighbors_[ind2]));
+
+			if (c > rowMax) {
+				rowMax = c;
+				ind2Max = ind2;
+			}
 		}
 
 		// Find the neighbor of point 1 that gives a similar orientation
-		float *col = &cosTheta[ind2Max];
+		const Point2f &ne2 = kPt2.neighbors_[ind2Max];
 		int ind1Max = 0;
+		float colMax = (table ? buffer[ind2Max] : cosTheta(pt1, kPt1.neighbors_[0], pt2, ne2));
 
 		for (unsigned int ind1_ = 1; ind1_ < nb1; ind1_++) {
-			if (col[ind1_ * nb2] > col[ind1Max * nb2]) ind1Max = ind1_;
+			float c = (table ? buffer[ind1_ * nb2 + ind2Max] : cosTheta(pt1, kPt1.neighbors_[ind1_], pt2, ne2));
+
+			if (c > colMax) {
+				colMax = c;
+				ind1Max = ind1_;
+			}
 		}
 
 		// Update the sum of cos(theta) if points 1 and 2 are mutually choosing each other
-		if (ind1Max == ind1) sumCosTheta += row[ind2Max];
+		if (ind1Max == ind1) sumCosTheta += rowMax;
 	}
 
-	delete[] cosTheta;
-
 	return (sumCosTheta / max(nb1, nb2));
 }
 
@@ -0,0 +1,240 @@
+#include "slKeyPointGraph.h"
+
+#include <slException.h>
+#include <algorithm>
+
+
+using namespace cv;
+using namespace std;
+
+
+// Sorts the indexes of the new vertices by position
+class slVertexLessThan
+{
+public:
+	slVertexLessThan(const vector<slKeyVertex> &vertices)
+	: vertices_(vertices)
+	{
+	}
+
+	bool operator()(int ind1, int ind2) const
+	{
+		return CvPoint2fLessThan()(vertices_[ind1].position, vertices_[ind2].position);
+	}
+
+private:
+	const vector<slKeyVertex> &vertices_;
+};
+
+
+slKeyPointGraph::slKeyPointGraph()
+: blobs_(1, 0), building_(false), stamp_(0)
+{
+}
+
+
+slKeyPointGraph::~slKeyPointGraph()
+{
+}
+
+
+void slKeyPointGraph::clear()
+{
+	vertices_.clear();
+	neighbors_.clear();
+	blobs_.resize(1);
+
+	building_ = false;
+	newVertices_.clear();
+	newArcs_.clear();
+	kStamps_.clear();
+	relDistStamps_.clear();
+}
+
+
+int slKeyPointGraph::beginBlob()
+{
+	if (building_) {
+		throw slException("slKeyPointGraph::beginBlob(): the previous blob is not ended.");
+	}
+
+	building_ = true;
+	stamp_ = 0;
+
+	return getNumOfBlobs();
+}
+
+
+int slKeyPointGraph::addVertex(const cv::Point2f &position)
+{
+	slKeyVertex vertex;
+
+	vertex.position = position;
+	vertex.firstNeighbor = 0;
+	vertex.nbNeighbors = 0;
+	vertex.descriptors = 0;
+	vertex.k = 0;
+	vertex.relDist = 0;
+
+	newVertices_.push_back(vertex);
+	kStamps_.push_back(-1);
+	relDistStamps_.push_back(-1);
+
+	return (int)newVertices_.size() - 1;
+}
+
+
+void slKeyPointGraph::setK(int vertex, float k)
+{
+	newVertices_[vertex].k = k;
+	newVertices_[vertex].descriptors |= KEYPT_K;
+	kStamps_[vertex] = stamp_++;
+}
+
+
+void slKeyPointGraph::setRelDist(int vertex, float relDist)
+{
+	newVertices_[vertex].relDist = relDist;
+	newVertices_[vertex].descriptors |= KEYPT_RELDIST;
+	relDistStamps_[vertex] = stamp_++;
+}
+
+
+void slKeyPointGraph::addNeighbor(int vertex, int neighbor)
+{
+	slArc arc = {vertex, neighbor};
+
+	newArcs_.push_back(arc);
+}
+
+
+void slKeyPointGraph::endBlob()
+{
+	if (!building_) {
+		throw slException("slKeyPointGraph::endBlob(): no blob to end.");
+	}
+
+	const int first = (int)vertices_.size();
+	const int nbNew = (int)newVertices_.size();
+
+	// Sort by position, points at the same position keep their order
+	order_.resize(nbNew);
+	newIndex_.resize(nbNew);
+
+	for (int ind = 0; ind < nbNew; ind++) order_[ind] = ind;
+
+	stable_sort(order_.begin(), order_.end(), slVertexLessThan(newVertices_));
+
+	// Merge the points at the same position
+	int kStamp = -1, relDistStamp = -1;
+
+	for (int ind = 0; ind < nbNew; ind++) {
+		const int newInd = order_[ind];
+		const slKeyVertex &vertex = newVertices_[newInd];
+
+		if ((int)vertices_.size() == first ||
+			CvPoint2fLessThan()(vertices_.back().position, vertex.position))
+		{
+			vertices_.push_back(vertex);
+			kStamp = kStamps_[newInd];
+			relDistStamp = relDistStamps_[newInd];
+		}
+		else {
+			// The descriptors set last win, like slKeyPoint::insert()
+			slKeyVertex &merged = vertices_.back();
+
+			if (kStamps_[newInd] > kStamp) {
+				merged.k = vertex.k;
+				kStamp = kStamps_[newInd];
+			}
+
+			if (relDistStamps_[newInd] > relDistStamp) {
+				merged.relDist = vertex.relDist;
+				relDistStamp = relDistStamps_[newInd];
+			}
+
+			merged.descriptors |= vertex.descriptors;
+		}
+
+		newIndex_[order_[ind]] = (int)vertices_.size() - 1;
+	}
+
+	// Count the neighbors, then place them in the order they were added
+	for (size_t ind = 0; ind < newArcs_.size(); ind++) {
+		vertices_[newIndex_[newArcs_[ind].from]].nbNeighbors++;
+	}
+
+	int next = (int)neighbors_.size();
+
+	for (int ind = first; ind < (int)vertices_.size(); ind++) {
+		vertices_[ind].firstNeighbor = next;
+		next += vertices_[ind].nbNeighbors;
+		vertices_[ind].nbNeighbors = 0;
+	}
+
+	neighbors_.resize(next);
+
+	for (size_t ind = 0; ind < newArcs_.size(); ind++) {
+		slKeyVertex &vertex = vertices_[newIndex_[newArcs_[ind].from]];
+
+		neighbors_[vertex.firstNeighbor + vertex.nbNeighbors++] = newIndex_[newArcs_[ind].to];
+	}
+
+	blobs_.push_back((int)vertices_.size());
+
+	building_ = false;
+	newVertices_.clear();
+	newArcs_.clear();
+	kStamps_.clear();
+	relDistStamps_.clear();
+}
+
+
+void slKeyPointGraph::append(const slKeyPointGraph &graph)
+{
+	if (building_ || graph.building_) {
+		throw slException("slKeyPointGraph::append(): a blob is not ended.");
+	}
+
+	const int vertexOffset = (int)vertices_.size();
+	const int neighborOffset = (int)neighbors_.size();
+
+	vertices_.insert(vertices_.end(), graph.vertices_.begin(), graph.vertices_.end());
+	neighbors_.insert(neighbors_.end(), graph.neighbors_.begin(), graph.neighbors_.end());
+
+	for (size_t ind = vertexOffset; ind < vertices_.size(); ind++) {
+		vertices_[ind].firstNeighbor += neighborOffset;
+	}
+
+	for (size_t ind = neighborOffset; ind < neighbors_.size(); ind++) {
+		neighbors_[ind] += vertexOffset;
+	}
+
+	for (size_t ind = 1; ind < graph.blobs_.size(); ind++) {
+		blobs_.push_back(graph.blobs_[ind] + vertexOffset);
+	}
+}
+
+
+slKeyPoints slKeyPointGraph::getKeyPoints(int blob) const
+{
+	slKeyPoints keyPoints;
+
+	// The vertices are already sorted, each one is inserted at the end
+	for (int ind = beginVertex(blob); ind < endVertex(blob); ind++) {
+		const slKeyVertex &vertex = vertices_[ind];
+		slKeyPoint &keyPoint = keyPoints.insert(keyPoints.end(),
+			slKeyPoints::value_type(vertex.position, slKeyPoint()))->second;
+
+		// Save its descriptors
+		keyPoint.moveTo(vertex.position);
+		if (vertex.descriptors & KEYPT_K) keyPoint.insert(slDceK(vertex.k));
+		if (vertex.descriptors & KEYPT_RELDIST) keyPoint.insert(slSkelRelDist(vertex.relDist));
+
+		for (int nb = 0; nb < vertex.nbNeighbors; nb++) {
+			keyPoint.insert(neighbor(vertex, nb));
+		}
+	}
+
+	return keyPoints;
+}
@@ -0,0 +1,267 @@
+#include "slKeyPointScorer.h"
+
+#include <algorithm>
+
+
+using namespace cv;
+using namespace std;
+
+
+void slKeyPointScorer::slBlobPoints::clear()
+{
+	x.clear(); y.clear(); k.clear(); relDist.clear();
+	descriptors.clear();
+	firstNeighbor.clear(); nbNeighbors.clear();
+	nx.clear(); ny.clear(); norm2.clear();
+}
+
+
+void slKeyPointScorer::slBlobPoints::add(const cv::Point2f &position, int desc, float kValue, float relDistValue)
+{
+	x.push_back(position.x);
+	y.push_back(position.y);
+	k.push_back(kValue);
+	relDist.push_back(relDistValue);
+	descriptors.push_back(desc);
+	firstNeighbor.push_back((int)nx.size());
+	nbNeighbors.push_back(0);
+}
+
+
+void slKeyPointScorer::slBlobPoints::addNeighbor(const cv::Point2f &neighbor)
+{
+	float ax = neighbor.x - x.back();
+	float ay = neighbor.y - y.back();
+
+	nx.push_back(ax);
+	ny.push_back(ay);
+	norm2.push_back(ax * ax + ay * ay);
+	nbNeighbors.back()++;
+}
+
+
+slKeyPointScorer::slKeyPointScorer(int terms)
+: terms_(terms), maxDistance_(0)
+{
+}
+
+
+slKeyPointScorer::~slKeyPointScorer()
+{
+}
+
+
+void slKeyPointScorer::setTerms(int terms)
+{
+	terms_ = terms;
+}
+
+
+void slKeyPointScorer::setGate(float maxDistance)
+{
+	maxDistance_ = (maxDistance > 0 ? maxDistance : 0);
+}
+
+
+void slKeyPointScorer::compare(const slKeyPointGraph &graph1, int blob1, const slKeyPointGraph &graph2, int blob2,
+							   float diagLength, cv::Mat_<float> &scores, int offsetX, int offsetY)
+{
+	load(graph1, blob1, points1_);
+	load(graph2, blob2, points2_);
+
+	compare(diagLength, scores, offsetX, offsetY);
+}
+
+
+void slKeyPointScorer::compare(const slKeyPoints &kPts1, const slKeyPoints &kPts2,
+							   float diagLength, cv::Mat_<float> &scores, int offsetX, int offsetY)
+{
+	load(kPts1, points1_);
+	load(kPts2, points2_);
+
+	compare(diagLength, scores, offsetX, offsetY);
+}
+
+
+void slKeyPointScorer::load(const slKeyPointGraph &graph, int blob, slBlobPoints &points) const
+{
+	points.clear();
+
+	for (int ind = graph.beginVertex(blob); ind < graph.endVertex(blob); ind++) {
+		const slKeyVertex &vertex = graph.vertex(ind);
+
+		points.add(vertex.position, vertex.descriptors, vertex.k, vertex.relDist);
+
+		for (int nb = 0; nb < vertex.nbNeighbors; nb++) {
+			points.addNeighbor(graph.neighbor(vertex, nb));
+		}
+	}
+}
+
+
+void slKeyPointScorer::load(const slKeyPoints &kPts, slBlobPoints &points) const
+{
+	points.clear();
+
+	for (slKeyPoints::const_iterator it = kPts.begin(); it != kPts.end(); it++) {
+		const slKeyPoint &kPt = it->second;
+		const slDceK *k = kPt.getK();
+		const slSkelRelDist *relDist = kPt.getRelDist();
+
+		points.add(kPt.position(),
+			(k != NULL ? KEYPT_K : 0) | (relDist != NULL ? KEYPT_RELDIST : 0),
+			(k != NULL ? k->k_ : 0), (relDist != NULL ? relDist->relDist_ : 0));
+
+		for (CvPt2fVector_t::const_iterator itNb = kPt.beginNeighbors();
+			itNb != kPt.endNeighbors(); itNb++)
+		{
+			points.addNeighbor(*itNb);
+		}
+	}
+}
+
+
+void slKeyPointScorer::compare(float diagLength, cv::Mat_<float> &scores, int offsetX, int offsetY)
+{
+	const slBlobPoints &p1 = points1_, &p2 = points2_;
+	const int n1 = p1.size(), n2 = p2.size();
+	const float maxDist2 = maxDistance_ * maxDistance_;
+
+	scores.create(n1, n2);
+	if (n1 == 0 || n2 == 0) return;
+
+	row_.resize(n2);
+	Mat_<float> row(1, n2, &row_[0]);	// Header on the buffer, for the vectorized functions
+
+	for (int ind1 = 0; ind1 < n1; ind1++) {
+		float *score = scores[ind1];
+		const float x1 = p1.x[ind1] + offsetX;
+		const float y1 = p1.y[ind1] + offsetY;
+
+		// Square distances of the whole row, and the gate
+		for (int ind2 = 0; ind2 < n2; ind2++) {
+			float diffx = x1 - p2.x[ind2];
+			float diffy = y1 - p2.y[ind2];
+
+			row_[ind2] = diffx * diffx + diffy * diffy;
+			score[ind2] = (maxDist2 > 0 && row_[ind2] > maxDist2 ? SCORE_REJECTED : 0);
+		}
+
+		// Sigmoid of the distances: 1 / (1 + exp(-3 + 6 * dist / diagLength))
+		if (terms_ & SCORE_EUCLIDEAN) {
+			cv::sqrt(row, row);
+			row.convertTo(row, -1, 6 / diagLength, -3);
+			cv::exp(row, row);
+
+			for (int ind2 = 0; ind2 < n2; ind2++) {
+				if (score[ind2] != SCORE_REJECTED) score[ind2] += 1 / (1 + row_[ind2]);
+			}
+		}
+
+		// cos(Theta) between the neighbors of this key point and all neighbors of the second blob
+		if (terms_ & SCORE_ORIENTATION) computeCosTheta(ind1);
+
+		// Other terms, for the pairs that are not rejected
+		for (int ind2 = 0; ind2 < n2; ind2++) {
+			if (score[ind2] == SCORE_REJECTED) continue;
+
+			if (terms_ & SCORE_ORIENTATION) {
+				score[ind2] += scoreOrientation(ind1, ind2);
+			}
+
+			if (terms_ & SCORE_NBNEIGHBORS) {
+				int nb1 = (p1.nbNeighbors[ind1] > 1 ? 3 : 1);
+				int nb2 = (p2.nbNeighbors[ind2] > 1 ? 3 : 1);
+
+				score[ind2] += (nb1 == nb2 ? 2.0f : 0.0f);
+			}
+
+			if ((terms_ & SCORE_K) && (p1.descriptors[ind1] & p2.descriptors[ind2] & KEYPT_K)) {
+				float k1 = p1.k[ind1], k2 = p2.k[ind2];
+				float length = std::sqrt(k1 * k1 + k2 * k2);
+
+				score[ind2] += -fabs(k1 - k2) / (length > 0 ? length : 1);
+			}
+
+			if ((terms_ & SCORE_RELDIST) && (p1.descriptors[ind1] & p2.descriptors[ind2] & KEYPT_RELDIST)) {
+				score[ind2] += -fabs(p1.relDist[ind1] - p2.relDist[ind2]);
+			}
+		}
+	}
+}
+
+
+void slKeyPointScorer::computeCosTheta(int ind1)
+{
+	const slBlobPoints &p1 = points1_, &p2 = points2_;
+	const int nb1 = p1.nbNeighbors[ind1], first1 = p1.firstNeighbor[ind1];
+	const int total2 = (int)p2.nx.size();
+
+	if (nb1 == 0 || total2 == 0) return;
+
+	if ((int)cosTheta_.size() < nb1 * total2) cosTheta_.resize(nb1 * total2);
+	if ((int)norms_.size() < total2) norms_.resize(total2);
+
+	// Headers on the buffers, for the vectorized functions
+	const Mat_<float> nx2(1, total2, const_cast<float*>(&p2.nx[0]));
+	const Mat_<float> ny2(1, total2, const_cast<float*>(&p2.ny[0]));
+	const Mat_<float> norm2(1, total2, const_cast<float*>(&p2.norm2[0]));
+	Mat_<float> norms(1, total2, &norms_[0]);
+
+	// Same operations as slKeyPoint::scoreOrientation(), a whole row at a time
+	for (int ne1 = 0; ne1 < nb1; ne1++) {
+		const float ax = p1.nx[first1 + ne1], ay = p1.ny[first1 + ne1], na = p1.norm2[first1 + ne1];
+		Mat_<float> cosTheta(1, total2, &cosTheta_[ne1 * total2]);
+
+		cv::multiply(nx2, Scalar(ax), cosTheta);
+		cv::scaleAdd(ny2, ay, cosTheta, cosTheta);
+		cv::multiply(norm2, Scalar(na), norms);
+		cv::sqrt(norms, norms);
+
+		// Not cv::divide(), which gives 0 instead of NaN for a null vector
+		float *row = &cosTheta_[ne1 * total2];
+
+		for (int ne2 = 0; ne2 < total2; ne2++) {
+			row[ne2] /= norms_[ne2];
+		}
+	}
+}
+
+
+float slKeyPointScorer::scoreOrientation(int ind1, int ind2) const
+{
+	const slBlobPoints &p1 = points1_, &p2 = points2_;
+	const int nb1 = p1.nbNeighbors[ind1];
+	const int nb2 = p2.nbNeighbors[ind2], first2 = p2.firstNeighbor[ind2];
+	const int total2 = (int)p2.nx.size();
+
+	if (nb1 == 0 || nb2 == 0) return 0;
+
+	// The cos(Theta) of this pair, from computeCosTheta()
+	const float *cosTheta = &cosTheta_[first2];
+	float sumCosTheta = 0.0f;
+
+	// For each neighbor of point 1
+	for (int ne1 = 0; ne1 < nb1; ne1++) {
+		const float *row = &cosTheta[ne1 * total2];
+		int ne2Max = 0;
+
+		// Find the neighbor of point 2 that gives a similar orientation
+		for (int ne2 = 1; ne2 < nb2; ne2++) {
+			if (row[ne2] > row[ne2Max]) ne2Max = ne2;
+		}
+
+		// Find the neighbor of point 1 that gives a similar orientation
+		const float *col = &cosTheta[ne2Max];
+		int ne1Max = 0;
+
+		for (int ne1_ = 1; ne1_ < nb1; ne1_++) {
+			if (col[ne1_ * total2] > col[ne1Max * total2]) ne1Max = ne1_;
+		}
+
+		// Update the sum of cos(theta) if points 1 and 2 are mutually choosing each other
+		if (ne1Max == ne1) sumCosTheta += row[ne2Max];
+	}
+
+	return (sumCosTheta / max(nb1, nb2));
+}
@@ -0,0 +1,449 @@
+#include "slMorphology.h"
+
+#include <slException.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <string.h>
+
+
+using namespace cv;
+using namespace std;
+
+
+#define RUN_INFINITY (1 << 29)	// Runs touching the border continue outside the image
+
+
+///////////////////////////////////////////////////////////////////////////////
+//	van Herk/Gil-Werman helpers
+///////////////////////////////////////////////////////////////////////////////
+
+
+struct MaxOp {
+	uchar operator()(uchar a, uchar b) const { return (a > b ? a : b); }
+};
+
+struct MinOp {
+	uchar operator()(uchar a, uchar b) const { return (a < b ? a : b); }
+};
+
+
+// dst[x] = op(src[x - anchor .. x - anchor + size - 1]), outside src is pad
+template <class Op>
+static void filterLine(const uchar *src, uchar *dst, int width, int size, int anchor, uchar pad,
+					   uchar *line, uchar *prefix, uchar *suffix)
+{
+	const int n = width + size - 1;
+	Op op;
+
+	// Padded line
+	memset(line, pad, anchor);
+	memcpy(line + anchor, src, width);
+	memset(line + anchor + width, pad, size - 1 - anchor);
+
+	// Forward and backward running values inside blocks of "size" pixels
+	for (int ind = 0; ind < n; ind++) {
+		prefix[ind] = (ind % size == 0 ? line[ind] : op(prefix[ind - 1], line[ind]));
+	}
+
+	suffix[n - 1] = line[n - 1];
+	for (int ind = n - 2; ind >= 0; ind--) {
+		suffix[ind] = (ind % size == size - 1 ? line[ind] : op(suffix[ind + 1], line[ind]));
+	}
+
+	// Any window covers the end of a block and the beginning of the next one
+	for (int x = 0; x < width; x++) {
+		dst[x] = op(suffix[x], prefix[x + size - 1]);
+	}
+}
+
+
+// Same as filterLine(), but on whole rows to walk the memory linearly
+template <class Op>
+static void filterColumns(slImage1ch &image, int size, int anchor, uchar pad,
+						  slImage1ch &prefix, slImage1ch &suffix)
+{
+	const int width = image.cols, height = image.rows;
+	const int n = height + size - 1;
+	Op op;
+
+	prefix.create(n, width);
+	suffix.create(n, width);
+
+	for (int ind = 0; ind < n; ind++) {
+		const int row = ind - anchor;
+		uchar *pre = prefix[ind];
+
+		if (row < 0 || row >= height) {
+			memset(pre, pad, width);
+			if (ind % size != 0) {
+				const uchar *prev = prefix[ind - 1];
+				for (int x = 0; x < width; x++) pre[x] = op(prev[x], pad);
+			}
+		}
+		else if (ind % size == 0) {
+			memcpy(pre, image[row], width);
+		}
+		else {
+			const uchar *prev = prefix[ind - 1], *src = image[row];
+			for (int x = 0; x < width; x++) pre[x] = op(prev[x], src[x]);
+		}
+	}
+
+	for (int ind = n - 1; ind >= 0; ind--) {
+		const int row = ind - anchor;
+		const uchar *src = (row < 0 || row >= height ? NULL : image[row]);
+		uchar *suf = suffix[ind];
+
+		if (ind == n - 1 || ind % size == size - 1) {
+			if (src != NULL) memcpy(suf, src, width);
+			else memset(suf, pad, width);
+		}
+		else {
+			const uchar *next = suffix[ind + 1];
+			if (src != NULL) {
+				for (int x = 0; x < width; x++) suf[x] = op(next[x], src[x]);
+			}
+			else {
+				for (int x = 0; x < width; x++) suf[x] = op(next[x], pad);
+			}
+		}
+	}
+
+	for (int row = 0; row < height; row++) {
+		const uchar *suf = suffix[row], *pre = prefix[row + size - 1];
+		uchar *dst = image[row];
+
+		for (int x = 0; x < width; x++) dst[x] = op(suf[x], pre[x]);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//	slMorphology
+///////////////////////////////////////////////////////////////////////////////
+
+
+slMorphology::slMorphology()
+: width_(0), separable_(false)
+{
+	setKernel(getStructuringElement(MORPH_ELLIPSE, Size(3, 3)));
+}
+
+
+slMorphology::~slMorphology()
+{
+}
+
+
+void slMorphology::setKernel(const cv::Mat &kernel)
+{
+	// Same default as OpenCV
+	Mat kernel8u = (kernel.empty() ? getStructuringElement(MORPH_RECT, Size(3, 3)) : kernel);
+
+	if (kernel8u.type() != CV_8UC1) {
+		throw slException("slMorphology::setKernel(): the kernel must be of type CV_8UC1");
+	}
+
+	kernelSize_ = kernel8u.size();
+	anchor_ = Point(kernelSize_.width / 2, kernelSize_.height / 2);
+
+	// One entry per run of ones on each row of the kernel
+	kernelRuns_.clear();
+
+	for (int row = 0; row < kernelSize_.height; row++) {
+		const uchar *ptr = kernel8u.ptr<uchar>(row);
+
+		for (int col = 0; col < kernelSize_.width; col++) {
+			if (ptr[col] != 0) {
+				slKernelRun run;
+
+				run.dy = row - anchor_.y;
+				run.first = col - anchor_.x;
+				while (col + 1 < kernelSize_.width && ptr[col + 1] != 0) col++;
+				run.last = col - anchor_.x;
+
+				kernelRuns_.push_back(run);
+			}
+		}
+	}
+
+	// Only large full rectangles go through the separable path
+	separable_ = (countNonZero(kernel8u) == kernelSize_.area() &&
+		(kernelSize_.width >= VHGW_MIN_KERNEL || kernelSize_.height >= VHGW_MIN_KERNEL));
+}
+
+
+void slMorphology::close(slImage1ch &image)
+{
+	if (image.empty() || kernelRuns_.empty()) return;
+
+	if (separable_) {
+		closeSeparable(image);
+	}
+	else {
+		encode(image);
+		dilateRuns();
+		erodeRuns();
+		decode(image);
+	}
+}
+
+
+void slMorphology::encode(const slImage1ch &image)
+{
+	const int width = image.cols, height = image.rows;
+
+	width_ = width;
+	runs_.clear();
+	rowRuns_.resize(height + 1);
+
+	for (int y = 0; y < height; y++) {
+		const uchar *row = image[y];
+		int x = 0;
+
+		rowRuns_[y] = (int)runs_.size();
+
+		while (x < width) {
+			// Skip the background, a word at a time when possible
+			while (x + (int)sizeof(size_t) <= width) {
+				size_t word;
+				memcpy(&word, row + x, sizeof(size_t));
+				if (word != 0) break;
+				x += sizeof(size_t);
+			}
+			while (x < width && row[x] == 0) x++;
+			if (x == width) break;
+
+			// Foreground run
+			slRun run;
+			run.begin = x;
+			while (x < width && row[x] != 0) x++;
+			run.end = x;
+
+			runs_.push_back(run);
+		}
+	}
+
+	rowRuns_[height] = (int)runs_.size();
+}
+
+
+void slMorphology::dilateRuns()
+{
+	const int height = (int)rowRuns_.size() - 1;
+	const int width = width_;
+
+	dilated_.clear();
+	rowDilated_.resize(height + 1);
+
+	for (int y = 0; y < height; y++) {
+		rowDilated_[y] = (int)dilated_.size();
+		tmp1_.clear();
+
+		// Union of the runs of all kernel rows, shifted by the kernel runs
+		for (vector<slKernelRun>::const_iterator kRun = kernelRuns_.begin(); kRun != kernelRuns_.end(); kRun++) {
+			const int row = y + kRun->dy;
+
+			if (row >= 0 && row < height && rowRuns_[row] != rowRuns_[row + 1]) {
+				unite(&runs_[rowRuns_[row]], &runs_[0] + rowRuns_[row + 1], kRun->first, kRun->last, width, tmp1_, tmp2_);
+				tmp1_.swap(tmp2_);
+			}
+		}
+
+		dilated_.insert(dilated_.end(), tmp1_.begin(), tmp1_.end());
+	}
+
+	rowDilated_[height] = (int)dilated_.size();
+}
+
+
+void slMorphology::erodeRuns()
+{
+	const int height = (int)rowDilated_.size() - 1;
+	const int width = width_;
+
+	eroded_.clear();
+	rowEroded_.resize(height + 1);
+
+	for (int y = 0; y < height; y++) {
+		rowEroded_[y] = (int)eroded_.size();
+
+		// Start from the full row and stop as soon as nothing is left
+		tmp1_.clear();
+		slRun all = {0, width};
+		tmp1_.push_back(all);
+
+		// Intersection of the runs of all kernel rows, shrinked by the kernel runs
+		for (vector<slKernelRun>::const_iterator kRun = kernelRuns_.begin();
+			kRun != kernelRuns_.end() && !tmp1_.empty(); kRun++)
+		{
+			const int row = y + kRun->dy;
+
+			// Outside the image, everything is foreground
+			if (row >= 0 && row < height) {
+				const slRun *begin = (rowDilated_[row] != rowDilated_[row + 1] ? &dilated_[rowDilated_[row]] : NULL);
+				const slRun *end = (begin != NULL ? begin + (rowDilated_[row + 1] - rowDilated_[row]) : NULL);
+
+				intersect(begin, end, kRun->first, kRun->last, width, tmp1_, tmp2_, allowed_);
+				tmp1_.swap(tmp2_);
+			}
+		}
+
+		eroded_.insert(eroded_.end(), tmp1_.begin(), tmp1_.end());
+	}
+
+	rowEroded_[height] = (int)eroded_.size();
+}
+
+
+void slMorphology::decode(slImage1ch &image) const
+{
+	const int height = image.rows;
+
+	for (int y = 0; y < height; y++) {
+		uchar *row = image[y];
+
+		// Clear the old runs, then paint the new ones
+		for (int ind = rowRuns_[y]; ind < rowRuns_[y + 1]; ind++) {
+			memset(row + runs_[ind].begin, PIXEL_1CH_BLACK, runs_[ind].end - runs_[ind].begin);
+		}
+
+		for (int ind = rowEroded_[y]; ind < rowEroded_[y + 1]; ind++) {
+			memset(row + eroded_[ind].begin, PIXEL_1CH_WHITE, eroded_[ind].end - eroded_[ind].begin);
+		}
+	}
+}
+
+
+void slMorphology::unite(const slRun *runs, const slRun *runsEnd, int first, int last, int width,
+						 const RunVector_t &src, RunVector_t &dst)
+{
+	RunVector_t::const_iterator itSrc = src.begin();
+
+	dst.clear();
+
+	while (runs != runsEnd || itSrc != src.end()) {
+		slRun run;
+
+		// Take the run that begins first
+		if (runs != runsEnd && (itSrc == src.end() || runs->begin - last < itSrc->begin)) {
+			// Pixel x is set if [x + first, x + last] touches the run
+			run.begin = max(runs->begin - last, 0);
+			run.end = min(runs->end - first, width);
+			runs++;
+		}
+		else {
+			run = *itSrc++;
+		}
+
+		if (run.begin >= run.end) continue;
+
+		// Merge overlapping or adjacent runs
+		if (!dst.empty() && run.begin <= dst.back().end) {
+			if (run.end > dst.back().end) dst.back().end = run.end;
+		}
+		else {
+			dst.push_back(run);
+		}
+	}
+}
+
+
+void slMorphology::intersect(const slRun *runs, const slRun *runsEnd, int first, int last, int width,
+							 const RunVector_t &src, RunVector_t &dst, RunVector_t &allowed)
+{
+	allowed.clear();
+
+	// Pixel x is allowed if [x + first, x + last] is inside a run or outside the image
+	slRun left = {-RUN_INFINITY, -last};
+	if (left.end > 0) allowed.push_back(left);
+
+	for (; runs != runsEnd; runs++) {
+		slRun run;
+
+		run.begin = (runs->begin == 0 ? -RUN_INFINITY : runs->begin - first);
+		run.end = (runs->end == width ? RUN_INFINITY : runs->end - last);
+
+		if (run.begin >= run.end) continue;
+
+		if (!allowed.empty() && run.begin <= allowed.back().end) {
+			if (run.end > allowed.back().end) allowed.back().end = run.end;
+		}
+		else {
+			allowed.push_back(run);
+		}
+	}
+
+	slRun right = {width - first, RUN_INFINITY};
+	if (right.begin < width) {
+		if (!allowed.empty() && right.begin <= allowed.back().end) {
+			allowed.back().end = RUN_INFINITY;
+		}
+		else {
+			allowed.push_back(right);
+		}
+	}
+
+	// Linear intersection of two sorted lists
+	RunVector_t::const_iterator itSrc = src.begin(), itAllowed = allowed.begin();
+
+	dst.clear();
+
+	while (itSrc != src.end() && itAllowed != allowed.end()) {
+		slRun run;
+
+		run.begin = max(itSrc->begin, itAllowed->begin);
+		run.end = min(itSrc->end, itAllowed->end);
+
+		if (run.begin < run.end) dst.push_back(run);
+
+		if (itSrc->end < itAllowed->end) itSrc++;
+		else itAllowed++;
+	}
+}
+
+
+void slMorphology::closeSeparable(slImage1ch &image)
+{
+	filterRows(image, true);
+	filterCols(image, true);
+	filterRows(image, false);
+	filterCols(image, false);
+}
+
+
+void slMorphology::filterRows(slImage1ch &image, bool dilate)
+{
+	const int size = kernelSize_.width;
+	const int n = image.cols + size - 1;
+
+	if (size == 1) return;
+
+	lineBuf_.resize(n);
+	prefix_.resize(n);
+	suffix_.resize(n);
+
+	for (int y = 0; y < image.rows; y++) {
+		uchar *row = image[y];
+
+		if (dilate) {
+			filterLine<MaxOp>(row, row, image.cols, size, anchor_.x, PIXEL_1CH_BLACK, &lineBuf_[0], &prefix_[0], &suffix_[0]);
+		}
+		else {
+			filterLine<MinOp>(row, row, image.cols, size, anchor_.x, PIXEL_1CH_WHITE, &lineBuf_[0], &prefix_[0], &suffix_[0]);
+		}
+	}
+}
+
+
+void slMorphology::filterCols(slImage1ch &image, bool dilate)
+{
+	if (kernelSize_.height == 1) return;
+
+	if (dilate) {
+		filterColumns<MaxOp>(image, kernelSize_.height, anchor_.y, PIXEL_1CH_BLACK, prefixRows_, suffixRows_);
+	}
+	else {
+		filterColumns<MinOp>(image, kernelSize_.height, anchor_.y, PIXEL_1CH_WHITE, prefixRows_, suffixRows_);
+	}
+}
@@ -22,17 +22,74 @@ class slContours_iterator;
 class slContours_const_iterator;
 
 
+//!	This class is a read-only view on the points of one contour
+/*!
+ *	slContours keeps all its points in one buffer, so a contour is
+ *	only a range of that buffer.  This view has the usual functions
+ *	of a std::vector (size(), empty(), operator[](), begin(), end()),
+ *	but it does not own the points: it is valid until the next call
+ *	to slContours::findAll() or slContours::clear().
+ *
+ *	mat() gives a cv::Mat header on the points without copying them.
+ *	When an owning slContour is really needed, the view is implicitly
+ *	converted (copied) to slContour.
+ *
+ *	\see		slContours, slContours_const_iterator
+ *	\date		October 2026
+ */
+class SLCORE_DLL_EXPORT slContourView
+{
+public:
+	typedef const cv::Point* const_iterator;	//!< Iterator type
+
+	slContourView(const cv::Point *begin = NULL, const cv::Point *end = NULL);	//!< Range [begin, end)
+	slContourView(const slContour &contour);									//!< View on a whole slContour
+
+	const_iterator begin() const { return begin_; }		//!< First point
+	const_iterator end() const { return end_; }			//!< After the last point
+
+	size_t size() const { return (size_t)(end_ - begin_); }		//!< Number of points
+	bool empty() const { return (begin_ == end_); }				//!< True if there is no point
+
+	const cv::Point& operator[](size_t index) const { return begin_[index]; }	//!< Point at index
+	const cv::Point& front() const { return *begin_; }							//!< First point
+	const cv::Point& back() const { return *(end_ - 1); }						//!< Last point
+
+	const cv::Mat mat() const;		//!< Returns a cv::Mat header (CV_32SC2, no copy)
+	operator slContour() const;		//!< Returns a copy of the points
+
+private:
+	const cv::Point *begin_;
+	const cv::Point *end_;
+
+};
+
+
+//!	This class gives operator->() to the slContours iterators
+class SLCORE_DLL_EXPORT slContourViewPtr
+{
+public:
+	slContourViewPtr(const slContourView &view) : view_(view) {}	//!< Constructor
+
+	const slContourView* operator->() const { return &view_; }		//!< Returns the slContourView*
+
+private:
+	slContourView view_;
+
+};
+
+
 //!	This class is the regular iterator for slContours objects
 /*!
  *	This iterator has a reference to the slContours object and
- *	an index to one of its slContour.
- *	Like a C pointer, the slContour is accessible by using the
- *	operator*() or the operator->() for slContour's methods.
+ *	an index to one of its contours.
+ *	Like a C pointer, the contour is accessible by using the
+ *	operator*() or the operator->() for slContourView's methods.
  *	There is also a mat() function to get the generic cv::Mat header.
  *	Finally, isNull() tells you if you have gone beyond a limit
  *	of the hierarchy of the slContours.
  *
- *	\see		slContours for examples, slContour, slContours_const_iterator
+ *	\see		slContours for examples, slContourView, slContours_const_iterator
  *	\author		Pier-Luc St-Onge
  *	\date		April 2011
  */
@@ -49,9 +106,12 @@ public:
 
 	bool isNull() const;		//!< True if index < 0 or if slContours* is NULL
 
-	cv::Mat mat();				//!< Returns explicitely a cv::Mat header for slContour
-	slContour& operator*();		//!< Returns the instance of slContour
-	slContour* operator->();	//!< Returns the slContour*
+	int id() const;					//!< Identity of the contour, see slContours::update()
+	const cv::Rect& rect() const;	//!< Bounding box of the contour
+
+	cv::Mat mat();						//!< Returns explicitely a cv::Mat header for the contour
+	slContourView operator*() const;		//!< Returns a view on the contour's points
+	slContourViewPtr operator->() const;	//!< For slContourView's methods
 
 	bool operator==(const slContours_iterator&) const;		//!< Same index and same slContours*
 	bool operator<(const slContours_iterator &it) const;	//!< For for and while loops, use isNull() instead
@@ -66,14 +126,14 @@ private:
 //!	This class is the const iterator for slContours objects
 /*!
  *	This iterator has a reference to the slContours object and
- *	an index to one of its slContour.
- *	Like a C pointer, the slContour is accessible by using the
- *	operator*() or the operator->() for slContour's methods.
+ *	an index to one of its contours.
+ *	Like a C pointer, the contour is accessible by using the
+ *	operator*() or the operator->() for slContourView's methods.
  *	There is also a mat() function to get the generic cv::Mat header.
  *	Finally, isNull() tells you if you have gone beyond a limit
  *	of the hierarchy of the slContours.
  *
- *	\see		slContours for examples, slContour, slContours_iterator
+ *	\see		slContours for examples, slContourView, slContours_iterator
  *	\author		Pier-Luc St-Onge
  *	\date		April 2011
  */
@@ -90,9 +150,12 @@ public:
 
 	bool isNull() const;		//!< True if index < 0 or if slContours* is NULL
 
-	const cv::Mat mat() const;				//!< Returns explicitely a cv::Mat header for slContour
-	const slContour& operator*() const;		//!< Returns the instance of slContour
-	const slContour* operator->() const;	//!< Returns the slContour*
+	int id() const;					//!< Identity of the contour, see slContours::update()
+	const cv::Rect& rect() const;	//!< Bounding box of the contour
+
+	const cv::Mat mat() const;				//!< Returns explicitely a cv::Mat header for the contour
+	slContourView operator*() const;		//!< Returns a view on the contour's points
+	slContourViewPtr operator->() const;	//!< For slContourView's methods
 
 	bool operator==(const slContours_const_iterator&) const;	//!< Same index and same slContours*
 	bool operator<(const slContours_const_iterator &it) const;	//!< For for and while loops, use isNull() instead
@@ -105,12 +168,27 @@ private:
 
 //!	This class contains an hierarchy of slContour instances
 /*!
- *	This class contains a vector of slContour objects.
- *	The hierarchy of these slContour objects is also defined in
+ *	This class contains a set of contours.
+ *	The hierarchy of these contours is also defined in
  *	another vector: next, previous, child and parent contour.
  *	The goal of this class is to replace the old but efficient
  *	CvContour.
  *
+ *	All the points are in one buffer, and a table of offsets tells
+ *	where each contour begins and ends.  The buffers (and the
+ *	CvMemStorage used by cvFindContours()) keep their capacity from
+ *	one call of findAll() to the next, so there is no allocation
+ *	once the largest frame has been seen.
+ *
+ *	When only a few blobs change from one frame to the next, update()
+ *	traces only the blobs touching the changed regions (dirty rectangles).
+ *	Each contour has an identity, id(), that does not change as long as the
+ *	contour is not modified, even if its index in the hierarchy changes.
+ *	The result of update() is the same set of contours as findAll(), in the
+ *	same order: the external contours are sorted by their first point, from
+ *	the last one in raster order to the first one, as cvFindContours() gives
+ *	them.  update() keeps its work buffers from one call to the next.
+ *
  *	The contours are accessible and browsable by the iterators.  Example:
  *	\code
  *	slImage1ch grayScaleImage = grayClone(rgbImage);
@@ -132,7 +210,7 @@ private:
  *	}
  *	\endcode
  *
- *	\see		slContour, slContours_iterator, slContours_const_iterator
+ *	\see		slContourView, slContours_iterator, slContours_const_iterator
  *	\author		Pier-Luc St-Onge
  *	\date		April 2011
  */
@@ -146,21 +224,55 @@ public:
 	friend class slContours_const_iterator;
 
 public:
-	slContours();							//!< Default constructor, empty vectors
-	slContours(const slContour &contour);	//!< Fills contours and hierarchy with this unique contour
+	slContours();								//!< Default constructor, empty vectors
+	slContours(const slContourView &contour);	//!< Fills contours and hierarchy with this unique contour
+	slContours(const slContours &contours);		//!< Copies the contours, not the storage
+	virtual ~slContours();
 
-	void clear();						//!< Clears both vectors (contours and hierarchy)
-	void findAll(slImage1ch &image);	//!< Calls \c cv::findContours() with \c CV_RETR_CCOMP and \c CV_CHAIN_APPROX_SIMPLE
+	slContours& operator=(const slContours &contours);	//!< Copies the contours, not the storage
+
+	void clear();						//!< Clears the buffers (contours and hierarchy), keeps their capacity
+	void findAll(slImage1ch &image);	//!< Calls \c cvFindContours() with \c CV_RETR_CCOMP and \c CV_CHAIN_APPROX_SIMPLE
+	void update(slImage1ch &image, const std::vector<cv::Rect> &dirtyRects);	//!< Same as findAll(), but only the blobs touching dirtyRects are traced again
 
 	iterator begin();				//!< Returns an iterator at index 0 or a null iterator
 	const_iterator begin() const;	//!< Returns an iterator at index 0 or a null iterator
 
-	std::vector<slContour>& all() { return contours_; }			//!< To get the contours
-	std::vector<cv::Vec4i>& hierarchy() { return hierarchy_; }	//!< To get the hierarchy
+	int size() const { return (int)hierarchy_.size(); }					//!< Number of contours
+	slContourView contour(int index) const;								//!< View on the contour at index
+	int id(int index) const { return ids_[index]; }						//!< Identity of the contour at index
+	const cv::Rect& rect(int index) const { return rects_[index]; }		//!< Bounding box of the contour at index
+
+	const std::vector<cv::Point>& points() const { return points_; }		//!< To get the points of all contours
+	const std::vector<int>& offsets() const { return offsets_; }			//!< Contour i is [offsets[i], offsets[i + 1])
+	const std::vector<cv::Vec4i>& hierarchy() const { return hierarchy_; }	//!< To get the hierarchy
+
+private:
+	void trace(slImage1ch &image, cv::Point offset);			// Appends the blobs found in image
+	void appendBlob(const slContours &source, int index);	// Appends a blob (external contour and holes) of source
+	void swapBuffers(slContours &contours);
 
 private:
-	std::vector<slContour> contours_;
+	std::vector<cv::Point> points_;
+	std::vector<int> offsets_;
 	std::vector<cv::Vec4i> hierarchy_;
+	std::vector<int> ids_;
+	std::vector<cv::Rect> rects_;
+
+	int nextId_;				// Next identity for a new contour
+	cv::Size imageSize_;		// Size of the last image, empty after clear()
+
+	CvMemStorage *storage_;		// For cvFindContours(), created on first use
+	slContours *traced_;		// For update(), created on first use
+	slContours *back_;			// For update(), created on first use
+	slImage1ch roi_;			// For update(), copy of a dirty region
+
+	// For update(), kept between calls
+	std::vector<cv::Rect> regions_;						// Regions to trace again
+	std::vector<int> blobs_;							// External contours
+	std::vector<bool> touched_;							// External contours to trace again
+	std::vector<std::pair<long long, int> > previous_;	// First point, contour traced again
+	std::vector<std::pair<long long, int> > order_;		// First point, blob of the result
 
 };
 
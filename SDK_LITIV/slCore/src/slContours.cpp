@@ -1,5 +1,8 @@
 #include "slContours.h"
 
+#include <algorithm>
+#include <functional>
+
 
 using namespace cv;
 
@@ -7,28 +10,392 @@ using namespace cv;
 enum Direction {NEXT, PREVIOUS, CHILD, PARENT};
 
 
+slContourView::slContourView(const cv::Point *begin, const cv::Point *end)
+: begin_(begin), end_(end)
+{
+}
+
+slContourView::slContourView(const slContour &contour)
+: begin_(contour.empty() ? NULL : &contour[0]), end_(contour.empty() ? NULL : &contour[0] + contour.size())
+{
+}
+
+
+const cv::Mat slContourView::mat() const
+{
+	// Same header as Mat(slContour), but without copying the points
+	return (empty() ? Mat() : Mat((int)size(), 1, CV_32SC2, (void*)begin_));
+}
+
+
+slContourView::operator slContour() const
+{
+	return slContour(begin_, end_);
+}
+
+
+// Rectangle grown by one pixel on each side (8-connectivity)
+static inline Rect grow(const Rect &rect)
+{
+	return Rect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2);
+}
+
+
+// Key for the first point of a contour
+static inline long long pointKey(const Point &pt)
+{
+	return ((long long)pt.y << 32) + (unsigned int)pt.x;
+}
+
+
 slContours::slContours()
+: nextId_(0), storage_(NULL), traced_(NULL), back_(NULL)
 {
+	offsets_.push_back(0);
 }
 
-slContours::slContours(const slContour &contour)
+slContours::slContours(const slContourView &contour)
+: nextId_(0), storage_(NULL), traced_(NULL), back_(NULL)
 {
-	contours_.push_back(contour);
+	points_.assign(contour.begin(), contour.end());
+	offsets_.push_back(0);
+	offsets_.push_back((int)points_.size());
 	hierarchy_.push_back(Vec4i(-1, -1, -1, -1));
+	ids_.push_back(nextId_++);
+	rects_.push_back(contour.empty() ? Rect() : boundingRect(contour.mat()));
+}
+
+slContours::slContours(const slContours &contours)
+: points_(contours.points_), offsets_(contours.offsets_), hierarchy_(contours.hierarchy_),
+  ids_(contours.ids_), rects_(contours.rects_), nextId_(contours.nextId_), imageSize_(contours.imageSize_),
+  storage_(NULL), traced_(NULL), back_(NULL)
+{
+}
+
+
+slContours::~slContours()
+{
+	if (storage_ != NULL) cvReleaseMemStorage(&storage_);
+
+	delete traced_;
+	delete back_;
+}
+
+
+slContours& slContours::operator=(const slContours &contours)
+{
+	if (this != &contours) {
+		// The buffers keep their capacity
+		points_.assign(contours.points_.begin(), contours.points_.end());
+		offsets_.assign(contours.offsets_.begin(), contours.offsets_.end());
+		hierarchy_.assign(contours.hierarchy_.begin(), contours.hierarchy_.end());
+		ids_.assign(contours.ids_.begin(), contours.ids_.end());
+		rects_.assign(contours.rects_.begin(), contours.rects_.end());
+
+		nextId_ = contours.nextId_;
+		imageSize_ = contours.imageSize_;
+	}
+
+	return *this;
 }
 
 
 void slContours::clear()
 {
-	contours_.clear();
+	points_.clear();
+	offsets_.resize(1);
 	hierarchy_.clear();
+	ids_.clear();
+	rects_.clear();
+
+	imageSize_ = Size();
 }
 
 
 void slContours::findAll(slImage1ch &image)
 {
 	clear();
-	cv::findContours(image, contours_, hierarchy_, CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE);
+	trace(image, Point());
+
+	imageSize_ = image.size();
+}
+
+
+void slContours::update(slImage1ch &image, const std::vector<cv::Rect> &dirtyRects)
+{
+	// Nothing to start from
+	if (imageSize_ != image.size()) {
+		findAll(image);
+		return;
+	}
+
+	const Rect imageRect(Point(), imageSize_);
+	std::vector<Rect> &regions = regions_;
+	regions.clear();
+
+	for (std::vector<Rect>::const_iterator it = dirtyRects.begin(); it != dirtyRects.end(); it++) {
+		const Rect rect = *it & imageRect;
+		if (rect.area() > 0) regions.push_back(rect);
+	}
+
+	if (regions.empty()) return;
+
+	// External contours
+	std::vector<int> &blobs = blobs_;
+	blobs.clear();
+
+	for (int ind = (size() > 0 ? 0 : -1); ind >= 0; ind = hierarchy_[ind][NEXT]) {
+		blobs.push_back(ind);
+	}
+
+	// A blob touching a region is traced again, and its bounding box
+	// is added to the regions, until no other blob touches the regions
+	std::vector<bool> &touched = touched_;
+	touched.assign(blobs.size(), false);
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		// Merge the regions that touch each other, the last region fills the hole
+		for (bool merged = true; merged; ) {
+			merged = false;
+
+			for (size_t ind = 0; ind < regions.size(); ind++) {
+				for (size_t other = ind + 1; other < regions.size(); other++) {
+					if ((grow(regions[ind]) & regions[other]).area() > 0) {
+						regions[ind] |= regions[other];
+						regions[other] = regions.back();
+						regions.pop_back();
+						other = ind;
+						merged = true;
+					}
+				}
+			}
+		}
+
+		for (size_t ind = 0; ind < blobs.size(); ind++) {
+			if (!touched[ind]) {
+				const Rect &rect = rects_[blobs[ind]];
+
+				for (size_t reg = 0; reg < regions.size(); reg++) {
+					if ((grow(regions[reg]) & rect).area() > 0) {
+						touched[ind] = changed = true;
+						regions.push_back(rect);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// Trace the regions again.  The border of a region is background,
+	// or it would belong to a touched blob, so each blob is complete.
+	if (traced_ == NULL) traced_ = new slContours();
+	traced_->clear();
+
+	for (std::vector<Rect>::const_iterator it = regions.begin(); it != regions.end(); it++) {
+		const Rect rect = grow(*it) & imageRect;
+
+		Mat(image, rect).copyTo(roi_);
+		traced_->trace(roi_, rect.tl());
+	}
+
+	// Unchanged contours keep their identity: the contours traced again,
+	// sorted by their first point (the index is -1 once the identity is taken)
+	std::vector<std::pair<long long, int> > &previous = previous_;
+	previous.clear();
+
+	for (size_t ind = 0; ind < blobs.size(); ind++) {
+		if (touched[ind]) {
+			previous.push_back(std::make_pair(pointKey(points_[offsets_[blobs[ind]]]), blobs[ind]));
+
+			for (int hole = hierarchy_[blobs[ind]][CHILD]; hole >= 0; hole = hierarchy_[hole][NEXT]) {
+				if (offsets_[hole] < offsets_[hole + 1]) {
+					previous.push_back(std::make_pair(pointKey(points_[offsets_[hole]]), hole));
+				}
+			}
+		}
+	}
+
+	std::sort(previous.begin(), previous.end());
+
+	for (int ind = 0; ind < traced_->size(); ind++) {
+		const slContourView contour = traced_->contour(ind);
+		int id = -1;
+
+		if (!contour.empty()) {
+			typedef std::vector<std::pair<long long, int> >::iterator PrevIterator_t;
+			const long long key = pointKey(contour.front());
+
+			for (PrevIterator_t it = std::lower_bound(previous.begin(), previous.end(), std::make_pair(key, -1));
+				it != previous.end() && it->first == key; it++)
+			{
+				if (it->second < 0) continue;
+
+				const slContourView old = this->contour(it->second);
+
+				if (old.size() == contour.size() && std::equal(old.begin(), old.end(), contour.begin())) {
+					id = ids_[it->second];
+					it->second = -1;
+					break;
+				}
+			}
+		}
+
+		traced_->ids_[ind] = (id >= 0 ? id : nextId_++);
+	}
+
+	// Kept blobs and traced blobs, sorted by their first point in reverse
+	// raster order, which is the order of cvFindContours() in findAll()
+	std::vector<std::pair<long long, int> > &order = order_;
+	order.clear();
+
+	for (size_t ind = 0; ind < blobs.size(); ind++) {
+		if (!touched[ind]) {
+			order.push_back(std::make_pair(pointKey(points_[offsets_[blobs[ind]]]), blobs[ind]));
+		}
+	}
+
+	for (int ind = (traced_->size() > 0 ? 0 : -1); ind >= 0; ind = traced_->hierarchy_[ind][NEXT]) {
+		order.push_back(std::make_pair(pointKey(traced_->points_[traced_->offsets_[ind]]), -1 - ind));
+	}
+
+	std::sort(order.begin(), order.end(), std::greater<std::pair<long long, int> >());
+
+	if (back_ == NULL) back_ = new slContours();
+	back_->clear();
+
+	for (std::vector<std::pair<long long, int> >::const_iterator it = order.begin(); it != order.end(); it++) {
+		if (it->second >= 0) back_->appendBlob(*this, it->second);
+		else back_->appendBlob(*traced_, -1 - it->second);
+	}
+
+	swapBuffers(*back_);
+}
+
+
+void slContours::trace(slImage1ch &image, cv::Point offset)
+{
+	if (storage_ == NULL) {
+		storage_ = cvCreateMemStorage();
+	}
+	else {
+		cvClearMemStorage(storage_);
+	}
+
+	// Same as cv::findContours(), but the points go in our buffers
+	CvMat cImage = image;
+	CvSeq *first = NULL;
+
+	cvFindContours(&cImage, storage_, &first, sizeof(CvContour), CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE, offset);
+
+	if (first == NULL) return;
+
+	CvSeq *all = cvTreeToNodeSeq(first, sizeof(CvSeq), storage_);
+	const int base = size();
+	const int total = all->total;
+
+	// Points and indexes
+	int nbPoints = (int)points_.size();
+
+	for (int ind = 0; ind < total; ind++) {
+		CvSeq *contour = *(CvSeq**)cvGetSeqElem(all, ind);
+
+		((CvContour*)contour)->color = base + ind;
+		nbPoints += contour->total;
+	}
+
+	points_.resize(nbPoints);
+	offsets_.resize(base + total + 1);
+	hierarchy_.resize(base + total);
+	ids_.resize(base + total);
+	rects_.resize(base + total);
+
+	for (int ind = base; ind < base + total; ind++) {
+		CvSeq *contour = *(CvSeq**)cvGetSeqElem(all, ind - base);
+
+		offsets_[ind + 1] = offsets_[ind] + contour->total;
+		if (contour->total > 0) cvCvtSeqToArray(contour, &points_[offsets_[ind]]);
+
+		// Hierarchy
+		hierarchy_[ind] = Vec4i(
+			contour->h_next ? ((CvContour*)contour->h_next)->color : -1,
+			contour->h_prev ? ((CvContour*)contour->h_prev)->color : -1,
+			contour->v_next ? ((CvContour*)contour->v_next)->color : -1,
+			contour->v_prev ? ((CvContour*)contour->v_prev)->color : -1);
+
+		ids_[ind] = nextId_++;
+		rects_[ind] = (contour->total > 0 ? boundingRect(this->contour(ind).mat()) : Rect());
+	}
+
+	// Chain with the external contours already there
+	if (base > 0) {
+		int last = base - 1;
+		while (hierarchy_[last][PARENT] >= 0) last--;
+
+		hierarchy_[last][NEXT] = base;
+		hierarchy_[base][PREVIOUS] = last;
+	}
+}
+
+
+void slContours::appendBlob(const slContours &source, int index)
+{
+	const int outer = size();
+
+	// Chain with the last external contour
+	int previous = -1;
+	if (outer > 0) {
+		previous = outer - 1;
+		while (hierarchy_[previous][PARENT] >= 0) previous--;
+
+		hierarchy_[previous][NEXT] = outer;
+	}
+
+	// External contour, then its holes
+	int last = -1;
+
+	for (int ind = index; ind >= 0; ind = (ind == index ? source.hierarchy_[index][CHILD] : source.hierarchy_[ind][NEXT])) {
+		const int current = size();
+		const slContourView contour = source.contour(ind);
+
+		points_.insert(points_.end(), contour.begin(), contour.end());
+		offsets_.push_back((int)points_.size());
+		ids_.push_back(source.ids_[ind]);
+		rects_.push_back(source.rects_[ind]);
+
+		if (ind == index) {
+			hierarchy_.push_back(Vec4i(-1, previous, -1, -1));
+		}
+		else {
+			// The first hole has no previous contour, as with cvFindContours
+			hierarchy_.push_back(Vec4i(-1, (last == outer ? -1 : last), -1, outer));
+
+			if (last == outer) hierarchy_[outer][CHILD] = current;
+			else hierarchy_[last][NEXT] = current;
+		}
+
+		last = current;
+	}
+}
+
+
+void slContours::swapBuffers(slContours &contours)
+{
+	points_.swap(contours.points_);
+	offsets_.swap(contours.offsets_);
+	hierarchy_.swap(contours.hierarchy_);
+	ids_.swap(contours.ids_);
+	rects_.swap(contours.rects_);
+}
+
+
+slContourView slContours::contour(int index) const
+{
+	const Point *data = (points_.empty() ? NULL : &points_[0]);
+
+	return slContourView(data + offsets_[index], data + offsets_[index + 1]);
 }
 
 
@@ -114,36 +481,58 @@ bool slContours_const_iterator::isNull() const
 }
 
 
+int slContours_iterator::id() const
+{
+	return ref_->ids_[index_];
+}
+
+int slContours_const_iterator::id() const
+{
+	return ref_->ids_[index_];
+}
+
+
+const cv::Rect& slContours_iterator::rect() const
+{
+	return ref_->rects_[index_];
+}
+
+const cv::Rect& slContours_const_iterator::rect() const
+{
+	return ref_->rects_[index_];
+}
+
+
 cv::Mat slContours_iterator::mat()
 {
-	return Mat(ref_->contours_[index_]);
+	return ref_->contour(index_).mat();
 }
 
 const cv::Mat slContours_const_iterator::mat() const
 {
-	return Mat(ref_->contours_[index_]);
+	return ref_->contour(index_).mat();
 }
 
 
-slContour& slContours_iterator::operator*()
+slContourView slContours_iterator::operator*() const
 {
-	return ref_->contours_[index_];
+	return ref_->contour(index_);
 }
 
-const slContour& slContours_const_iterator::operator*() const
+slContourView slContours_const_iterator::operator*() const
 {
-	return ref_->contours_[index_];
+	return ref_->contour(index_);
 }
 
 
-slContour* slContours_iterator::operator->()
+slContourViewPtr slContours_iterator::operator->() const
 {
-	return &ref_->contours_[index_];
+	return slContourViewPtr(ref_->contour(index_));
 }
 
-const slContour* slContours_const_iterator::operator->() const
+slContourViewPtr slContours_const_iterator::operator->() const
 {
-	return &ref_->contours_[index_];
+	return slContourViewPtr(ref_->contour(index_));
 }
 
 
@@ -15,6 +15,8 @@ using namespace std;
 
 void paint(const slImage1ch &fg, const slContours &contours, const slBlobAnalyzer *ba, slImage3ch &output);
 void paintKeyPoints(const slKeyPoints &kPt, cv::Scalar color, slImage3ch &output);
+void paintMatches(const slKeyPointGraph &previous, const slKeyPointGraph &current, slKeyPointScorer &scorer,
+				  float diagLength, slImage3ch &output);
 
 
 // Usage: -i ..\..\..\mediaFiles\stereo1_thermal.avi bgSub: -a tempAVG -bf 8 -bfg contour: -c 3 3 blobAn: -a 5 -ba dce -n 16
@@ -79,6 +81,11 @@ int main(int argc, char **argv)
 		slClock horloge;
 		slImage3ch imSource;
 		slImage1ch bForeground, fgTemp;
+		slKeyPointGraph previousGraph;		// Key points of the previous frame
+		slKeyPointScorer scorer(ba->getScoreTerms());
+		const float diagLength = (float)sqrt((double)videoIn.getWidth() * videoIn.getWidth() + (double)videoIn.getHeight() * videoIn.getHeight());
+
+		scorer.setGate(0.05f * diagLength);	// Only the key points that moved a little
 
 		/*slImageOut imOut1, imOut2;
 		imOut1.open("contour.png");
@@ -97,6 +104,8 @@ int main(int argc, char **argv)
 			ba->analyzeAllBlobs(contourEngine->getContours());
 
 			paint(bForeground, contourEngine->getContours(), ba, imSource);
+			paintMatches(previousGraph, ba->getGraph(), scorer, diagLength, imSource);
+			previousGraph = ba->getGraph();
 			winGraph.show(imSource);
 			waitKey(horloge.nextDelay());
 
@@ -170,3 +179,41 @@ void paintKeyPoints(const slKeyPoints &kPt, cv::Scalar color, slImage3ch &output
 }
 
 
+void paintMatches(const slKeyPointGraph &previous, const slKeyPointGraph &current, slKeyPointScorer &scorer,
+				  float diagLength, slImage3ch &output)
+{
+	Mat_<float> scores;
+	vector<float> bestScores;
+	vector<Point2f> bestPositions;
+
+	// Each key point is linked to the key point of the previous frame with the best score
+	for (int blob2 = 0; blob2 < current.getNumOfBlobs(); blob2++) {
+		const int first2 = current.beginVertex(blob2);
+		const int nb2 = current.endVertex(blob2) - first2;
+
+		bestScores.assign(nb2, SCORE_REJECTED);
+		bestPositions.resize(nb2);
+
+		// All pairs of key points of the two blobs at once
+		for (int blob1 = 0; blob1 < previous.getNumOfBlobs(); blob1++) {
+			const int first1 = previous.beginVertex(blob1);
+
+			scorer.compare(previous, blob1, current, blob2, diagLength, scores);
+
+			for (int ind1 = 0; ind1 < scores.rows; ind1++) {
+				for (int ind2 = 0; ind2 < nb2; ind2++) {
+					if (scores(ind1, ind2) > bestScores[ind2]) {
+						bestScores[ind2] = scores(ind1, ind2);
+						bestPositions[ind2] = previous.vertex(first1 + ind1).position;
+					}
+				}
+			}
+		}
+
+		for (int ind2 = 0; ind2 < nb2; ind2++) {
+			if (bestScores[ind2] != SCORE_REJECTED) {
+				line(output, Point(bestPositions[ind2]), Point(current.vertex(first2 + ind2).position), CV_RGB(255, 255, 0));
+			}
+		}
+	}
+}
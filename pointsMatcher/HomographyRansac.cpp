@@ -0,0 +1,306 @@
+#include "HomographyRansac.h"
+#include "opencv2/calib3d/calib3d.hpp"
+#include <float.h>
+#include <math.h>
+
+
+// Rsout l'homographie (h[8] = 1) qui envoie exactement les 4 points de l'chantillon sur leurs matches.
+// Faux si 3 des points sont aligns (ou confondus) dans une des images.
+static bool solve4Points(const float *x1, const float *y1, const float *x2, const float *y2, const int *echantillon, double *h)
+{
+	// Deux fois l'aire de chaque triangle de l'chantillon, dans les deux images
+	for (int i = 0; i < 4; ++i)
+	{
+		const int a = echantillon[i], b = echantillon[(i + 1) % 4], c = echantillon[(i + 2) % 4];
+
+		if (fabs((x1[b] - x1[a]) * (y1[c] - y1[a]) - (y1[b] - y1[a]) * (x1[c] - x1[a])) < 1 ||
+			fabs((x2[b] - x2[a]) * (y2[c] - y2[a]) - (y2[b] - y2[a]) * (x2[c] - x2[a])) < 1)
+			return false;
+	}
+
+	double a[64], b[8], x[8];
+
+	for (int i = 0; i < 4; ++i)
+	{
+		const double u = x1[echantillon[i]], v = y1[echantillon[i]];
+		const double up = x2[echantillon[i]], vp = y2[echantillon[i]];
+		double *l1 = &a[16*i], *l2 = &a[16*i + 8];
+
+		l1[0] = u; l1[1] = v; l1[2] = 1; l1[3] = 0; l1[4] = 0; l1[5] = 0; l1[6] = -up*u; l1[7] = -up*v;
+		l2[0] = 0; l2[1] = 0; l2[2] = 0; l2[3] = u; l2[4] = v; l2[5] = 1; l2[6] = -vp*u; l2[7] = -vp*v;
+		b[2*i] = up;
+		b[2*i + 1] = vp;
+	}
+
+	cv::Mat A(8, 8, CV_64F, a), B(8, 1, CV_64F, b), X(8, 1, CV_64F, x);
+
+	if (!cv::solve(A, B, X, cv::DECOMP_LU))
+		return false;
+
+	for (int i = 0; i < 8; ++i)
+		h[i] = x[i];
+	h[8] = 1;
+
+	return true;
+}
+
+// Nombre de points dont l'erreur de reprojection est au plus le seuil (masque des inliers si demand).
+// Boucles sans branchement sur des tableaux de float : vectorises par le compilateur.
+static int countInliers(const double *h, const float *x1, const float *y1, const float *x2, const float *y2, int total, float seuil2, unsigned char *inliers = NULL)
+{
+	const float h0 = (float)h[0], h1 = (float)h[1], h2 = (float)h[2];
+	const float h3 = (float)h[3], h4 = (float)h[4], h5 = (float)h[5];
+	const float h6 = (float)h[6], h7 = (float)h[7], h8 = (float)h[8];
+	int nbInliers = 0;
+
+	if (inliers == NULL)
+	{
+		for (int i = 0; i < total; ++i)
+		{
+			float w = 1 / (h6*x1[i] + h7*y1[i] + h8);
+			float dx = (h0*x1[i] + h1*y1[i] + h2) * w - x2[i];
+			float dy = (h3*x1[i] + h4*y1[i] + h5) * w - y2[i];
+
+			nbInliers += (dx*dx + dy*dy <= seuil2);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < total; ++i)
+		{
+			float w = 1 / (h6*x1[i] + h7*y1[i] + h8);
+			float dx = (h0*x1[i] + h1*y1[i] + h2) * w - x2[i];
+			float dy = (h3*x1[i] + h4*y1[i] + h5) * w - y2[i];
+
+			inliers[i] = (dx*dx + dy*dy <= seuil2);
+			nbInliers += inliers[i];
+		}
+	}
+
+	return nbInliers;
+}
+
+// Rsolution et valuation des hypothses d'un bloc, une par itration
+class HypothesesBody : public cv::ParallelLoopBody
+{
+public:
+	HypothesesBody(const float *x1, const float *y1, const float *x2, const float *y2, int total, float seuil2,
+		const int *echantillons, double *hypotheses, int *scores)
+	: x1_(x1), y1_(y1), x2_(x2), y2_(y2), total_(total), seuil2_(seuil2),
+	  echantillons_(echantillons), hypotheses_(hypotheses), scores_(scores)
+	{
+	}
+
+	void operator()(const cv::Range &range) const
+	{
+		for (int i = range.start; i < range.end; ++i)
+		{
+			double *h = hypotheses_ + 9*i;
+
+			if (solve4Points(x1_, y1_, x2_, y2_, echantillons_ + 4*i, h))
+				scores_[i] = countInliers(h, x1_, y1_, x2_, y2_, total_, seuil2_);
+			else
+				scores_[i] = 0;
+		}
+	}
+
+private:
+	const float *x1_, *y1_, *x2_, *y2_;
+	int total_;
+	float seuil2_;
+	const int *echantillons_;
+	double *hypotheses_;
+	int *scores_;
+};
+
+
+HomographyRansac::HomographyRansac(float seuil, double confiance, int nbIterationsMax)
+: seuil_(seuil), confiance_(confiance), nbIterationsMax_(nbIterationsMax), graine_(RANSAC_GRAINE), rng_(RANSAC_GRAINE),
+  nbIterations_(0), nbInliers_(0)
+{
+}
+
+void HomographyRansac::setSeuil(float seuil)
+{
+	seuil_ = seuil;
+}
+
+void HomographyRansac::setConfiance(double confiance)
+{
+	confiance_ = confiance;
+}
+
+void HomographyRansac::setNbIterationsMax(int nbIterationsMax)
+{
+	nbIterationsMax_ = nbIterationsMax;
+}
+
+void HomographyRansac::setGraine(uint64 graine)
+{
+	graine_ = graine;
+}
+
+bool HomographyRansac::compute(const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, cv::Mat &homography, std::vector<unsigned char> *inliers)
+{
+	const int total = points1.size();
+	const float seuil2 = seuil_ * seuil_;
+	double meilleure[9];
+	int nbMeilleure = 0;
+	int nbNecessaires = nbIterationsMax_;
+
+	nbIterations_ = 0;
+	nbInliers_ = 0;
+
+	if (total < 4 || points2.size() != points1.size())
+		return false;
+
+	// Mme suite d'chantillons pour les mmes points
+	rng_ = cv::RNG(graine_);
+
+	x1_.resize(total);
+	y1_.resize(total);
+	x2_.resize(total);
+	y2_.resize(total);
+	masque_.resize(total);
+
+	for (int i = 0; i < total; ++i)
+	{
+		x1_[i] = points1[i].x;
+		y1_[i] = points1[i].y;
+		x2_[i] = points2[i].x;
+		y2_[i] = points2[i].y;
+	}
+
+	while (nbIterations_ < nbNecessaires)
+	{
+		const int nbHypotheses = std::min(RANSAC_NB_HYPOTHESES_BLOC, nbNecessaires - nbIterations_);
+
+		echantillons_.resize(4 * nbHypotheses);
+		hypotheses_.resize(9 * nbHypotheses);
+		scores_.resize(nbHypotheses);
+
+		// Les chantillons sont tirs avant le bloc : le rsultat ne dpend pas du nombre de threads
+		for (int i = 0; i < nbHypotheses; ++i)
+			tirerEchantillon(total, &echantillons_[4*i]);
+
+		cv::parallel_for_(cv::Range(0, nbHypotheses), HypothesesBody(&x1_[0], &y1_[0], &x2_[0], &y2_[0], total, seuil2,
+			&echantillons_[0], &hypotheses_[0], &scores_[0]));
+
+		nbIterations_ += nbHypotheses;
+
+		// Meilleure hypothse du bloc (la premire en cas d'galit), si elle bat la meilleure jusqu'ici
+		int meilleurBloc = -1;
+
+		for (int i = 0; i < nbHypotheses; ++i)
+		{
+			if (scores_[i] > (meilleurBloc < 0 ? nbMeilleure : scores_[meilleurBloc]))
+				meilleurBloc = i;
+		}
+
+		if (meilleurBloc < 0)
+			continue;
+
+		std::copy(&hypotheses_[9*meilleurBloc], &hypotheses_[9*meilleurBloc] + 9, meilleure);
+		nbMeilleure = scores_[meilleurBloc];
+
+		optimiser(meilleure, nbMeilleure);
+		nbNecessaires = nbIterationsNecessaires(nbMeilleure, total);
+	}
+
+	if (nbMeilleure < 4)
+		return false;
+
+	nbInliers_ = countInliers(meilleure, &x1_[0], &y1_[0], &x2_[0], &y2_[0], total, seuil2, &masque_[0]);
+
+	cv::Mat(3, 3, CV_64F, meilleure).copyTo(homography);
+
+	if (inliers != NULL)
+		inliers->assign(masque_.begin(), masque_.end());
+
+	return true;
+}
+
+void HomographyRansac::tirerEchantillon(int total, int *echantillon)
+{
+	// 4 indices diffrents
+	for (int i = 0; i < 4; ++i)
+	{
+		bool doublon;
+
+		do
+		{
+			echantillon[i] = rng_.uniform(0, total);
+			doublon = false;
+
+			for (int j = 0; j < i; ++j)
+				doublon = doublon || (echantillon[j] == echantillon[i]);
+		}
+		while (doublon);
+	}
+}
+
+void HomographyRansac::optimiser(double *h, int &nbInliers)
+{
+	const int total = x1_.size();
+	const float seuil2 = seuil_ * seuil_;
+
+	// Moindres carrs sur les inliers, tant que le nombre d'inliers augmente
+	for (int it = 0; it < RANSAC_NB_ITERATIONS_LO; ++it)
+	{
+		countInliers(h, &x1_[0], &y1_[0], &x2_[0], &y2_[0], total, seuil2, &masque_[0]);
+
+		inliers1_.clear();
+		inliers2_.clear();
+
+		for (int i = 0; i < total; ++i)
+		{
+			if (masque_[i])
+			{
+				inliers1_.push_back(cv::Point2f(x1_[i], y1_[i]));
+				inliers2_.push_back(cv::Point2f(x2_[i], y2_[i]));
+			}
+		}
+
+		if (inliers1_.size() < 4)
+			return;
+
+		cv::Mat H = cv::findHomography(inliers1_, inliers2_, 0);
+
+		if (H.empty() || fabs(H.at<double>(2, 2)) < DBL_EPSILON)
+			return;
+
+		double hLO[9];
+
+		for (int i = 0; i < 9; ++i)
+			hLO[i] = H.at<double>(i / 3, i % 3) / H.at<double>(2, 2);
+
+		int nb = countInliers(hLO, &x1_[0], &y1_[0], &x2_[0], &y2_[0], total, seuil2);
+
+		//  galit, l'homographie des moindres carrs est garde (moins sensible au bruit que 4 points)
+		if (nb < nbInliers)
+			return;
+
+		std::copy(hLO, hLO + 9, h);
+
+		if (nb == nbInliers)
+			return;
+
+		nbInliers = nb;
+	}
+}
+
+int HomographyRansac::nbIterationsNecessaires(int nbInliers, int total) const
+{
+	// Probabilit qu'un chantillon de 4 points soit sans outlier
+	const double p = pow((double)nbInliers / total, 4);
+	const double num = log(1 - confiance_);
+	const double den = log(1 - p);
+
+	if (p >= 1)
+		return 0;
+
+	if (den >= 0 || num <= nbIterationsMax_ * den)
+		return nbIterationsMax_;
+
+	return cvRound(num / den);
+}
@@ -0,0 +1,60 @@
+#ifndef __HOMOGRAPHY_RANSAC_H__
+#define __HOMOGRAPHY_RANSAC_H__
+
+#include <vector>
+#include "opencv2/core/core.hpp"
+
+#define RANSAC_SEUIL 3					// Erreur de reprojection maximum d'un inlier (pixels), comme cvFindHomography
+#define RANSAC_CONFIANCE 0.995			// Probabilite d'avoir tire au moins un echantillon sans outlier
+#define RANSAC_NB_ITERATIONS_MAX 2000	// Nombre maximum d'hypotheses
+#define RANSAC_NB_HYPOTHESES_BLOC 64	// Hypotheses evaluees en parallele entre deux tests d'arret
+#define RANSAC_NB_ITERATIONS_LO 4		// Iterations de l'optimisation locale (moindres carres sur les inliers)
+#define RANSAC_GRAINE 0xffffffff		// Graine par defaut du generateur (celle de cv::RNG)
+
+// Estimation robuste d'une homographie (points1 vers points2) par LO-RANSAC.
+// Chaque hypothese vient de 4 correspondances (systeme lineaire 8x8). Les hypotheses sont
+// evaluees par blocs de RANSAC_NB_HYPOTHESES_BLOC, reparties entre les threads ; les echantillons
+// sont tires avant chaque bloc, donc le resultat ne depend que de la graine.
+// Apres chaque bloc, la meilleure hypothese est raffinee par moindres carres sur ses inliers
+// (optimisation locale), puis le nombre d'hypotheses necessaire est mis a jour avec la confiance.
+class HomographyRansac
+{
+public:
+	HomographyRansac(float seuil = RANSAC_SEUIL, double confiance = RANSAC_CONFIANCE, int nbIterationsMax = RANSAC_NB_ITERATIONS_MAX);
+
+	void setSeuil(float seuil);
+	void setConfiance(double confiance);
+	void setNbIterationsMax(int nbIterationsMax);
+	void setGraine(uint64 graine);			// Le generateur repart de la graine a chaque compute()
+
+	// Homographie 3x3 en CV_64F, false s'il n'y a pas assez de points ou pas d'hypothese valide
+	bool compute(const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, cv::Mat &homography, std::vector<unsigned char> *inliers = NULL);
+
+	int getNbIterations() const { return nbIterations_; }		// Hypotheses evaluees au dernier compute()
+	int getNbInliers() const { return nbInliers_; }
+
+private:
+	void tirerEchantillon(int total, int *echantillon);
+	void optimiser(double *h, int &nbInliers);
+	int nbIterationsNecessaires(int nbInliers, int total) const;
+
+private:
+	float seuil_;
+	double confiance_;
+	int nbIterationsMax_;
+	uint64 graine_;
+	cv::RNG rng_;
+
+	int nbIterations_;
+	int nbInliers_;
+
+	// Tampons gardes d'un appel a l'autre
+	std::vector<float> x1_, y1_, x2_, y2_;		// Points en structure de tableaux
+	std::vector<int> echantillons_;				// 4 indices par hypothese du bloc
+	std::vector<double> hypotheses_;			// 9 coefficients par hypothese du bloc
+	std::vector<int> scores_;					// Nombre d'inliers de chaque hypothese du bloc
+	std::vector<unsigned char> masque_;
+	std::vector<cv::Point2f> inliers1_, inliers2_;
+};
+
+#endif
@@ -52,18 +52,23 @@ void KeyPt::determinerSecteur(cv::Point2f ptMin, cv::Point2f ptMax)
 
 void KeyPt::determinerConvexite()
 {
-	cv::Vec3f va = cv::Vec3f(position_.x - voisins_.at(0).x, position_.y - voisins_.at(0).y, 0.0);
-	cv::Vec3f vb = cv::Vec3f(voisins_.at(1).x - position_.x, voisins_.at(1).y - position_.y, 0.0);
+	convexite_ = calculerConvexite(position_, voisins_.at(0), voisins_.at(1));
+}
+
+int KeyPt::calculerConvexite(const cv::Point2f &position, const cv::Point2f &voisin0, const cv::Point2f &voisin1)
+{
+	cv::Vec3f va = cv::Vec3f(position.x - voisin0.x, position.y - voisin0.y, 0.0);
+	cv::Vec3f vb = cv::Vec3f(voisin1.x - position.x, voisin1.y - position.y, 0.0);
 	
 	cv::Vec3f vc = va.cross(vb);
 	if (vc(2) > 0)
 	{
-		convexite_ = CONCAVE;
+		return CONCAVE;
 		//std::cout << "CONCAVE :  x : " << vc(0) << "   y : " << vc(1) << "   z : " << vc(2) << std::endl;
 	}
 	else
 	{
-		convexite_ = CONVEXE;
+		return CONVEXE;
 		//std::cout << "CONVEXE :  x : " << vc(0) << "   y : " << vc(1) << "   z : " << vc(2) << std::endl;
 	}
 }
@@ -76,30 +81,37 @@ void KeyPt::determinerDistanceCentroid()
 
 void KeyPt::determinerDistancesVoisins()
 {
-	cv::Point2f vecTemp;
-
 	for (unsigned int i = 0; i < voisins_.size(); ++i)
 	{
-		vecTemp = position_ - voisins_.at(i);
-		distancesVoisins_.push_back( sqrt( (vecTemp.x*vecTemp.x) + (vecTemp.y*vecTemp.y) ) );
+		distancesVoisins_.push_back(calculerDistance(position_, voisins_.at(i)));
 	}
 }
 
+float KeyPt::calculerDistance(const cv::Point2f &pt1, const cv::Point2f &pt2)
+{
+	cv::Point2f vecTemp = pt1 - pt2;
+	return sqrt( (vecTemp.x*vecTemp.x) + (vecTemp.y*vecTemp.y) );
+}
+
 void KeyPt::determinerAngle()
+{
+	angle_ = calculerAngle(distancesVoisins_.at(0), distancesVoisins_.at(1), voisins_.at(0), voisins_.at(1));
+	//std::cout << "angle " << angle_ << std::endl << std::endl;
+}
+
+float KeyPt::calculerAngle(float distanceVoisin0, float distanceVoisin1, const cv::Point2f &voisin0, const cv::Point2f &voisin1)
 {
 	// On calcule d'abord la distance entre les 2 voisins
-	cv::Point2f vecTemp = voisins_.at(0) - voisins_.at(1);
-	float distanceEntreVoisins = sqrt( (vecTemp.x*vecTemp.x) + (vecTemp.y*vecTemp.y) );
-	angle_ = acos
+	float distanceEntreVoisins = calculerDistance(voisin0, voisin1);
+	float angle = acos
 				(    
-					(distancesVoisins_.at(0)*distancesVoisins_.at(0) 
-					+ distancesVoisins_.at(1)*distancesVoisins_.at(1) 
-					- distanceEntreVoisins * distanceEntreVoisins) / (2 * distancesVoisins_.at(0)*distancesVoisins_.at(1))
+					(distanceVoisin0*distanceVoisin0 
+					+ distanceVoisin1*distanceVoisin1 
+					- distanceEntreVoisins * distanceEntreVoisins) / (2 * distanceVoisin0*distanceVoisin1)
 				);
 
 	// Conversion de radian ver degr
-	angle_ = angle_*(float)180/(float)3.14159265;
-	//std::cout << "angle " << angle_ << std::endl << std::endl;
+	return angle*(float)180/(float)3.14159265;
 }
 
 void KeyPt::determinerDirectionAngle()
@@ -33,31 +33,36 @@ public:
 	void clearVoisins();
 	void clearDistancesVoisins();
 
-	// GET
-	cv::Point2f getPosition(){return position_;}
-	cv::Point2f getCentroid(){return centroid_;}
-	int getSecteur(){return secteur_;}
-	int getConvexite(){return convexite_;}
-	std::vector<cv::Point2f> getVoisins(){return voisins_;}
-	float getAngle(){return angle_;}
-	cv::Point2f getDirectionAngle(){return directionAngle_;}
+	// Calculs d'un sommet a partir de ses 2 voisins (precedent et suivant), partages avec KeyPtBlob
+	static int calculerConvexite(const cv::Point2f &position, const cv::Point2f &voisin0, const cv::Point2f &voisin1);
+	static float calculerDistance(const cv::Point2f &pt1, const cv::Point2f &pt2);
+	static float calculerAngle(float distanceVoisin0, float distanceVoisin1, const cv::Point2f &voisin0, const cv::Point2f &voisin1);
+
+	// GET (references constantes, sans copie)
+	const cv::Point2f& getPosition() const {return position_;}
+	const cv::Point2f& getCentroid() const {return centroid_;}
+	int getSecteur() const {return secteur_;}
+	int getConvexite() const {return convexite_;}
+	const std::vector<cv::Point2f>& getVoisins() const {return voisins_;}
+	float getAngle() const {return angle_;}
+	const cv::Point2f& getDirectionAngle() const {return directionAngle_;}
 	//cv::Point2f getDirectionAngle(){return directionAngle_;}
-	float getDistancesCentroid(){return distanceCentroid_;}	
-	std::vector<float> getDistancesVoisins(){return distancesVoisins_;}	
-	std::pair<cv::Point2f, cv::Point2f> getBoundingBox(){return boundingBox_;}	
+	float getDistancesCentroid() const {return distanceCentroid_;}	
+	const std::vector<float>& getDistancesVoisins() const {return distancesVoisins_;}	
+	const std::pair<cv::Point2f, cv::Point2f>& getBoundingBox() const {return boundingBox_;}	
 
 	// SET
-	void setPosition(cv::Point2f position){position_ = position;}
-	void setCentroid(cv::Point2f centroid){centroid_ = centroid;}
+	void setPosition(const cv::Point2f &position){position_ = position;}
+	void setCentroid(const cv::Point2f &centroid){centroid_ = centroid;}
 	void setSecteur(int secteur){secteur_ = secteur;}
 	void setConvexite(int convexite){convexite_ = convexite;}
-	void setVoisins(std::vector<cv::Point2f> voisins){voisins_ = voisins;}
+	void setVoisins(const std::vector<cv::Point2f> &voisins){voisins_ = voisins;}
 	void setAngle(float angle){angle_ = angle;}
-	void setDirectionAngle(cv::Point2f directionAngle){directionAngle_ = directionAngle;}
+	void setDirectionAngle(const cv::Point2f &directionAngle){directionAngle_ = directionAngle;}
 	//void setDirectionAngle(cv::Point2f directionAngle){directionAngle_ = directionAngle;}
 	void setDistancesCentroid(float distancesCentroid){distancesCentroid = distancesCentroid;}
-	void setDistancesVoisins(std::vector<float> distancesVoisins){distancesVoisins_ = distancesVoisins;}
-	void setBoundingBox(std::pair<cv::Point2f, cv::Point2f> boundingBox){boundingBox_ = boundingBox;}
+	void setDistancesVoisins(const std::vector<float> &distancesVoisins){distancesVoisins_ = distancesVoisins;}
+	void setBoundingBox(const std::pair<cv::Point2f, cv::Point2f> &boundingBox){boundingBox_ = boundingBox;}
 	void clear();
 private:
 	cv::Point2f position_;
@@ -0,0 +1,116 @@
+#include "KeyPtBlob.h"
+
+
+KeyPtBlob::KeyPtBlob()
+: area(0)
+{
+}
+
+void KeyPtBlob::clear()
+{
+	x.clear();
+	y.clear();
+	convexite.clear();
+	angle.clear();
+	distancePrec.clear();
+	distanceSuiv.clear();
+	hasDescriptor.clear();
+
+	centroid = cv::Point2f();
+	boundingBox = std::make_pair(cv::Point2f(), cv::Point2f());
+	area = 0;
+}
+
+void KeyPtBlob::reserve(unsigned int total)
+{
+	x.reserve(total);
+	y.reserve(total);
+	convexite.reserve(total);
+	angle.reserve(total);
+	distancePrec.reserve(total);
+	distanceSuiv.reserve(total);
+}
+
+void KeyPtBlob::resize(unsigned int total)
+{
+	x.resize(total);
+	y.resize(total);
+	convexite.resize(total);
+	angle.resize(total);
+	distancePrec.resize(total);
+	distanceSuiv.resize(total);
+}
+
+void KeyPtBlob::push_back(const KeyPtVertex &vertex)
+{
+	x.push_back(vertex.position.x);
+	y.push_back(vertex.position.y);
+	convexite.push_back(vertex.convexite);
+	angle.push_back(vertex.angle);
+	distancePrec.push_back(vertex.distancesVoisins[0]);
+	distanceSuiv.push_back(vertex.distancesVoisins[1]);
+}
+
+void KeyPtBlob::assign(const std::vector<KeyPt> &keyPts)
+{
+	KeyPtVertex vertex;
+
+	clear();
+	reserve(keyPts.size());
+
+	for (unsigned int i = 0; i < keyPts.size(); ++i)
+	{
+		vertex.position = keyPts.at(i).getPosition();
+		vertex.convexite = keyPts.at(i).getConvexite();
+		vertex.angle = keyPts.at(i).getAngle();
+		vertex.distancesVoisins[0] = keyPts.at(i).getDistancesVoisins().at(0);
+		vertex.distancesVoisins[1] = keyPts.at(i).getDistancesVoisins().at(1);
+
+		push_back(vertex);
+	}
+
+	// Tous les points d'un blob ont le mme boundingbox et le mme centrode
+	if (!keyPts.empty())
+	{
+		centroid = keyPts.at(0).getCentroid();
+		boundingBox = keyPts.at(0).getBoundingBox();
+	}
+
+	computeArea();
+}
+
+void KeyPtBlob::computeArea()
+{
+	const unsigned int total = size();
+	float somme = 0;
+
+	// Formule du lacet, le polygone est dans l'ordre du contour
+	for (unsigned int i = 0; i < total; ++i)
+	{
+		unsigned int suiv = (i + 1 < total ? i + 1 : 0);
+		somme += x[i] * y[suiv] - x[suiv] * y[i];
+	}
+
+	area = fabs(somme) / 2;
+}
+
+KeyPtVertex KeyPtBlob::getVertex(int i) const
+{
+	KeyPtVertex vertex;
+
+	vertex.position = getPosition(i);
+	vertex.convexite = convexite[i];
+	vertex.angle = angle[i];
+	vertex.distancesVoisins[0] = distancePrec[i];
+	vertex.distancesVoisins[1] = distanceSuiv[i];
+
+	return vertex;
+}
+
+const unsigned char* KeyPtBlob::getDescriptor(int i) const
+{
+	if ((unsigned int)i >= hasDescriptor.size() || !hasDescriptor[i])
+		return NULL;
+
+	return descriptors.ptr(i);
+}
@@ -0,0 +1,58 @@
+#ifndef __KEY_PT_BLOB_H__
+#define __KEY_PT_BLOB_H__
+
+#include "KeyPt.h"
+
+// Sommet d'un blob : enregistrement de taille fixe, sans vecteur (copiable par memcpy)
+struct KeyPtVertex
+{
+	cv::Point2f position;
+	int convexite;
+	float angle;
+	float distancesVoisins[2];		// Distances au voisin precedent et au voisin suivant
+};
+
+// Sommets d'un blob en structure de tableaux, un element par sommet dans l'ordre du contour.
+// Les boucles de matching ne lisent que les tableaux dont elles ont besoin.
+// Le boundingbox et le centroide sont gardes une seule fois pour le blob.
+class KeyPtBlob
+{
+public:
+	KeyPtBlob();
+
+	void clear();
+	void reserve(unsigned int total);
+	void resize(unsigned int total);
+	void push_back(const KeyPtVertex &vertex);
+	void assign(const std::vector<KeyPt> &keyPts);		// Memes sommets que les KeyPt, boundingbox et centroide du premier
+	void computeArea();									// Aire du polygone des sommets
+
+	unsigned int size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	cv::Point2f getPosition(int i) const { return cv::Point2f(x[i], y[i]); }
+	KeyPtVertex getVertex(int i) const;
+	const unsigned char* getDescriptor(int i) const;		// NULL si le sommet n'a pas de descripteur
+
+public:
+	// Un element par sommet
+	std::vector<float> x, y;
+	std::vector<int> convexite;
+	std::vector<float> angle;
+	std::vector<float> distancePrec, distanceSuiv;
+
+	// Tampons de Outils::convert2KeyPt() : vecteur de chaque sommet vers le suivant.
+	// Separes des tableaux de sortie, pour que ses boucles ne lisent et n'ecrivent pas la meme memoire
+	std::vector<float> dx, dy;
+
+	// Descripteurs binaires optionnels (Outils::computeDescriptors), une ligne par sommet
+	cv::Mat descriptors;
+	std::vector<unsigned char> hasDescriptor;
+
+	// Un seul pour le blob
+	cv::Point2f centroid;
+	std::pair<cv::Point2f, cv::Point2f> boundingBox;
+	float area;
+};
+
+#endif
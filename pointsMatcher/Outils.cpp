@@ -2,81 +2,268 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 namespace Outils
 {
-	CvMat* Ransac(std::vector<Point> &points1, std::vector<Point> &points2)
+	KeyPtGrid::KeyPtGrid()
+	: cellSize_(RADIUS_MIN), cols_(0), rows_(0), descriptorSize_(0), cellStart_(1, 0)
 	{
-		// La taille des deux vecteurs doivent tre identiques
-		if (points1.size() == points2.size())
+	}
+
+	KeyPtGrid::KeyPtGrid(const std::vector<KeyPt> &keyPoints, float cellSize)
+	{
+		build(keyPoints, cellSize);
+	}
+
+	void KeyPtGrid::build(const std::vector<KeyPt> &keyPoints, float cellSize)
+	{
+		clear(cellSize);
+
+		for (unsigned int i = 0; i < keyPoints.size(); ++i)
 		{
-			unsigned int taille = points1.size();
-			int ind = 0;
-			int t = 0;
+			add(keyPoints.at(i).getPosition(), keyPoints.at(i).getConvexite(), keyPoints.at(i).getAngle());
+			points_.push_back(&keyPoints.at(i));
+		}
+
+		index();
+	}
+
+	void KeyPtGrid::build(const std::vector<std::vector<KeyPt>> &vecKeyPoints, float cellSize)
+	{
+		clear(cellSize);
 
-			float *mat1 = new float[taille*2];
-			float *mat2 = new float[taille*2];
+		// Mme ordre que les blobs insrs un  un au dbut d'un seul vecteur
+		for (unsigned int it = vecKeyPoints.size(); it > 0; --it)
+		{
+			const std::vector<KeyPt> &keyPoints = vecKeyPoints.at(it - 1);
 
-			for (unsigned int i = 0; i < taille; ++i)
+			for (unsigned int i = 0; i < keyPoints.size(); ++i)
 			{
-				mat1[t] = (float)points1.at(i).x;
-				mat1[t+1] = (float)points1.at(i).y;
+				add(keyPoints.at(i).getPosition(), keyPoints.at(i).getConvexite(), keyPoints.at(i).getAngle());
+				points_.push_back(&keyPoints.at(i));
+			}
+		}
+
+		index();
+	}
+
+	void KeyPtGrid::build(const std::vector<KeyPtBlob> &vecBlobs, float cellSize)
+	{
+		clear(cellSize);
+
+		// Mme ordre que pour les vecteurs de KeyPt
+		for (unsigned int it = vecBlobs.size(); it > 0; --it)
+		{
+			const KeyPtBlob &blob = vecBlobs.at(it - 1);
 
-				mat2[t] = (float)points2.at(i).x;
-				mat2[t+1] = (float)points2.at(i).y;
+			// Tous les descripteurs viennent du mme extracteur
+			if (!blob.hasDescriptor.empty())
+				descriptorSize_ = blob.descriptors.cols;
 
-				t += 2;
+			for (unsigned int i = 0; i < blob.size(); ++i)
+			{
+				add(blob.getPosition(i), blob.convexite[i], blob.angle[i], blob.getDescriptor(i));
+				blobs_.push_back(&blob);
+				vertices_.push_back(i);
+				blobIndexes_.push_back(it - 1);
 			}
+		}
 
-			CvMat mImgGauche, mImgDroite;
-			cvInitMatHeader(&mImgGauche,   taille, 2, CV_32FC1, mat1);
-			cvInitMatHeader(&mImgDroite,   taille, 2, CV_32FC1, mat2);
+		index();
+	}
 
-			CvMat *h1 = cvCreateMat(3, 3, CV_32FC1);
-			cvFindHomography(&mImgGauche, &mImgDroite, h1, CV_RANSAC);
+	void KeyPtGrid::clear(float cellSize)
+	{
+		cellSize_ = cellSize;
+		positions_.clear();
+		convexites_.clear();
+		angles_.clear();
+		descriptors_.clear();
+		descriptorSize_ = 0;
+		points_.clear();
+		blobs_.clear();
+		vertices_.clear();
+		blobIndexes_.clear();
+	}
 
-			return h1;
+	void KeyPtGrid::add(const cv::Point2f &position, int convexite, float angle, const unsigned char *descriptor)
+	{
+		positions_.push_back(position);
+		convexites_.push_back(convexite);
+		angles_.push_back(angle);
+		descriptors_.push_back(descriptor);
+	}
+
+	void KeyPtGrid::index()
+	{
+		const unsigned int total = positions_.size();
+
+		cols_ = 0;
+		rows_ = 0;
+		cellStart_.assign(1, 0);
+		indexes_.clear();
+
+		if (total == 0)
+			return;
+
+		// Boundingbox de tous les points
+		cv::Point2f ptMin = positions_[0], ptMax = ptMin;
+
+		for (unsigned int i = 1; i < total; ++i)
+		{
+			const cv::Point2f &position = positions_[i];
+
+			ptMin.x = std::min(ptMin.x, position.x);
+			ptMin.y = std::min(ptMin.y, position.y);
+			ptMax.x = std::max(ptMax.x, position.x);
+			ptMax.y = std::max(ptMax.y, position.y);
 		}
 
-		else
+		origin_ = ptMin;
+		cols_ = (int)((ptMax.x - ptMin.x) / cellSize_) + 1;
+		rows_ = (int)((ptMax.y - ptMin.y) / cellSize_) + 1;
+
+		// Tri par dnombrement : les points d'une cellule gardent leur ordre
+		cellStart_.assign(cols_ * rows_ + 1, 0);
+		cells_.resize(total);
+
+		for (unsigned int i = 0; i < total; ++i)
+		{
+			const cv::Point2f &position = positions_[i];
+			int col = std::min((int)((position.x - origin_.x) / cellSize_), cols_ - 1);
+			int row = std::min((int)((position.y - origin_.y) / cellSize_), rows_ - 1);
+
+			cells_[i] = cellOf(col, row);
+			cellStart_[cells_[i] + 1]++;
+		}
+
+		for (unsigned int c = 1; c < cellStart_.size(); ++c)
+			cellStart_[c] += cellStart_[c - 1];
+
+		next_.assign(cellStart_.begin(), cellStart_.end() - 1);
+		indexes_.resize(total);
+
+		for (unsigned int i = 0; i < total; ++i)
+			indexes_[next_[cells_[i]]++] = i;
+	}
+
+	void KeyPtGrid::getCells(const cv::Point2f &position, float radius, int &colMin, int &colMax, int &rowMin, int &rowMax) const
+	{
+		if (indexes_.empty())
+		{
+			colMin = rowMin = 0;
+			colMax = rowMax = -1;
+			return;
+		}
+
+		colMin = std::max((int)floor((position.x - radius - origin_.x) / cellSize_), 0);
+		colMax = std::min((int)floor((position.x + radius - origin_.x) / cellSize_), cols_ - 1);
+		rowMin = std::max((int)floor((position.y - radius - origin_.y) / cellSize_), 0);
+		rowMax = std::min((int)floor((position.y + radius - origin_.y) / cellSize_), rows_ - 1);
+	}
+
+	void KeyPtGrid::query(const cv::Point2f &position, float radius, std::vector<int> &candidates) const
+	{
+		int colMin, colMax, rowMin, rowMax;
+
+		candidates.clear();
+		getCells(position, radius, colMin, colMax, rowMin, rowMax);
+
+		for (int row = rowMin; row <= rowMax; ++row)
+		{
+			for (int col = colMin; col <= colMax; ++col)
+				candidates.insert(candidates.end(), beginCell(col, row), endCell(col, row));
+		}
+
+		// Mme ordre que le parcours complet des points
+		std::sort(candidates.begin(), candidates.end());
+	}
+
+	// Homographie de points1 vers points2 par HomographyRansac (graine fixe : mme rsultat d'une excution  l'autre),
+	// dans une matrice 3x3 CV_32FC1  librer avec cvReleaseMat, NULL si elle n'a pas pu tre estime
+	static CvMat* Ransac(const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2)
+	{
+		HomographyRansac ransac;
+		cv::Mat homography;
+
+		if (!ransac.compute(points1, points2, homography))
 			return NULL;
+
+		CvMat *h1 = cvCreateMat(3, 3, CV_32FC1);
+		cv::Mat h1Mat(h1);
+		homography.convertTo(h1Mat, CV_32FC1);
+
+		return h1;
 	}
 
-	CvMat* Ransac(std::vector<KeyPt> &points1, std::vector<KeyPt> &points2)
+	CvMat* Ransac(std::vector<Point> &points1, std::vector<Point> &points2)
 	{
 		// La taille des deux vecteurs doivent tre identiques
-		if (points1.size() == points2.size())
-		{
-			unsigned int taille = points1.size();
-			int ind = 0;
-			int t = 0;
+		if (points1.size() != points2.size())
+			return NULL;
 
-			float *mat1 = new float[taille*2];
-			float *mat2 = new float[taille*2];
+		std::vector<cv::Point2f> pts1(points1.begin(), points1.end()), pts2(points2.begin(), points2.end());
 
-			for (unsigned int i = 0; i < taille; ++i)
-			{
-				mat1[t] = (float)points1.at(i).getPosition().x;
-				mat1[t+1] = (float)points1.at(i).getPosition().y;
+		return Ransac(pts1, pts2);
+	}
 
-				mat2[t] = (float)points2.at(i).getPosition().x;
-				mat2[t+1] = (float)points2.at(i).getPosition().y;
+	CvMat* Ransac(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2)
+	{
+		RansacBuffers buffers;
+		cv::Mat transMat;
 
-				t += 2;
-			}
+		if (!Ransac(points1, points2, buffers, transMat))
+			return NULL;
 
-			CvMat mImgGauche, mImgDroite;
-			cvInitMatHeader(&mImgGauche,   taille, 2, CV_32FC1, mat1);
-			cvInitMatHeader(&mImgDroite,   taille, 2, CV_32FC1, mat2);
-			delete[] mat1;
-			delete[] mat2;
-			CvMat *h1 = cvCreateMat(3, 3, CV_32FC1);
-			cvFindHomography(&mImgGauche, &mImgDroite, h1, CV_RANSAC);
+		CvMat *h1 = cvCreateMat(3, 3, CV_32FC1);
+		cv::Mat h1Mat(h1);
+		transMat.copyTo(h1Mat);
+
+		return h1;
+	}
+
+	// Mme homographie, dans transMat (3x3 CV_32FC1, garde intacte en cas d'chec) ; le moteur et les
+	// tampons de l'appelant sont rutiliss, donc pas d'allocation une fois la plus grande frame vue
+	bool Ransac(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, RansacBuffers &buffers, cv::Mat &transMat)
+	{
+		// La taille des deux vecteurs doivent tre identiques
+		if (points1.size() != points2.size())
+			return false;
+
+		const unsigned int taille = points1.size();
+		buffers.points1.resize(taille);
+		buffers.points2.resize(taille);
 
-			return h1;
+		for (unsigned int i = 0; i < taille; ++i)
+		{
+			buffers.points1[i] = points1.at(i).position;
+			buffers.points2[i] = points2.at(i).position;
 		}
 
-		else
+		if (!buffers.ransac.compute(buffers.points1, buffers.points2, buffers.homography))
+			return false;
+
+		buffers.homography.convertTo(transMat, CV_32FC1);
+
+		return true;
+	}
+
+	CvMat* Ransac(std::vector<KeyPt> &points1, std::vector<KeyPt> &points2)
+	{
+		// La taille des deux vecteurs doivent tre identiques
+		if (points1.size() != points2.size())
 			return NULL;
+
+		const unsigned int taille = points1.size();
+		std::vector<cv::Point2f> pts1(taille), pts2(taille);
+
+		for (unsigned int i = 0; i < taille; ++i)
+		{
+			pts1[i] = points1.at(i).getPosition();
+			pts2[i] = points2.at(i).getPosition();
+		}
+
+		return Ransac(pts1, pts2);
 	}
 
 	std::vector<CvMat*> CV_Ransac_Simple(std::vector<Point> points1, std::vector<Point> points2)
@@ -273,6 +460,11 @@ namespace Outils
 	}
 
 	std::vector<slKeyPoints> extractKeysPoints(const slContours &contours, const slBlobAnalyzer *ba)
+	{
+		return extractKeysPoints(contours, ba->getResult());
+	}
+
+	std::vector<slKeyPoints> extractKeysPoints(const slContours &contours, const slBlobResult &result)
 	{
 		// Empty output image
 		//output.create(fg.size());
@@ -284,17 +476,17 @@ namespace Outils
 		for (slContours::const_iterator contour = contours.begin();
 			!contour.isNull(); contour = contour.next())
 		{
-			if (ba->hasKeyPoints(contour)) {
-				//paintKeyPoints(ba->getKeyPoints(contour), CV_RGB(0, 255, 0), output);
-				keyPoints.push_back(ba->getKeyPoints(contour));
+			if (result.hasKeyPoints(contour)) {
+				//paintKeyPoints(result.getKeyPoints(contour), CV_RGB(0, 255, 0), output);
+				keyPoints.push_back(result.getKeyPoints(contour));
 
 				// For each hole or internal contour
 				//for (slContours::const_iterator child = contour.child();
 				//	!child.isNull(); child = child.next())
 				//{
-				//	if (ba->hasKeyPoints(child)) {
-				//		keyPoints.push_back(ba->getKeyPoints(child));
-				//		//paintKeyPoints(ba->getKeyPoints(child), CV_RGB(255, 0, 0), output);
+				//	if (result.hasKeyPoints(child)) {
+				//		keyPoints.push_back(result.getKeyPoints(child));
+				//		//paintKeyPoints(result.getKeyPoints(child), CV_RGB(255, 0, 0), output);
 				//	}
 				//}
 			}
@@ -344,6 +536,26 @@ namespace Outils
 		}
 	}
 
+	void paintKeyPoints(const slImage1ch fg, const std::vector<KeyPtBlob> &vecBlobs, cv::Scalar vertexColor, cv::Scalar edgeColor, slImage3ch &output)
+	{
+		output.create(fg.size());
+		output = 0;
+
+		for (unsigned int k = 0; k < vecBlobs.size(); ++k)
+		{
+			const KeyPtBlob &blob = vecBlobs.at(k);
+
+			for (unsigned int l = 0; l < blob.size(); ++l)
+			{
+				if (l == 0)
+					circle(output, blob.getPosition(l), 2, CV_RGB(255, 0, 0), 1, 8, 0);
+				else
+					circle(output, blob.getPosition(l), 2, vertexColor, 1, 8, 0);
+				line(output, blob.getPosition(l), blob.getPosition((l + 1) % blob.size()), edgeColor);
+			}
+		}
+	}
+
 	void paintKeyPoints(const slImage1ch fg, std::vector<std::vector<KeyPt>> vecKeyPts, cv::Scalar vertexColor, cv::Scalar edgeColor, slImage3ch &output)
 	{
 		output.create(fg.size());
@@ -382,103 +594,73 @@ namespace Outils
 
 		return kps;
 	}
-	std::vector<Point> pointsTransform(std::vector<Point> points, cv::Mat transMat)
+	std::vector<Point> pointsTransform(const std::vector<Point> &points, const cv::Mat &transMat)
 	{
 		std::vector<Point> modifiedPoints;
-		Point2f src;
-		Point dst;
 
-		for (unsigned int i = 0; i < points.size(); ++i)
-		{
-			src = points.at(i);
+		pointsTransform(points, transMat, modifiedPoints);
+		return modifiedPoints;
+	}
 
-			vector<Point3f> vec; 
+	std::vector<KeyPt> pointsTransform(const std::vector<KeyPt> &points, const cv::Mat &transMat)
+	{
+		std::vector<KeyPt> modifiedPoints;
 
-			// On change le point 2D en point 3D
-			vec.push_back(Point3f(src.x,src.y,1)); 
+		pointsTransform(points, transMat, modifiedPoints);
+		return modifiedPoints;
+	}
 
-			// On applique une transpos pour avoir la bonne orientation de la matrice avant la multiplication
-			Mat srcMat = Mat(vec).reshape(1).t(); 
-			Mat dstMat = transMat*srcMat; // Faire la multiplication 
+	std::vector<std::vector<KeyPt>> pointsTransform(const std::vector<std::vector<KeyPt>> &points, const cv::Mat &transMat)
+	{
+		std::vector<std::vector<KeyPt>> modifiedPoints;
 
-			// Suite < la multiplication, on obtient un vecteur [a, b, c] o c est diffrent de 1
-			// Il faut normaliser afin de ramener en un vecteur 2D
-			// Pour ce faire, on divise a et b par c -> a = a/c et b = b/c
-			// dstMat.at<float>(0,0) = a,  dstMat.at<float>(1,0) = b  et dstMat.at<float>(2,0) = c
-			dst = (Point) Point2f(dstMat.at<float>(0,0) / dstMat.at<float>(2,0), dstMat.at<float>(1,0) / dstMat.at<float>(2,0)); 
-			//std::cout<<dst.x<<" "<<dst.y<<std::endl; 
-			modifiedPoints.push_back(dst);
-		}
+		pointsTransform(points, transMat, modifiedPoints);
 		return modifiedPoints;
 	}
 
-	std::vector<KeyPt> pointsTransform(std::vector<KeyPt> points, cv::Mat transMat)
+	void pointsTransform(const std::vector<Point> &points, const cv::Mat &transMat, std::vector<Point> &modifiedPoints)
 	{
-		std::vector<KeyPt> modifiedPoints;
-		Point2f src;
-		Point2f dst;
+		modifiedPoints.resize(points.size());
 
 		for (unsigned int i = 0; i < points.size(); ++i)
-		{
-			src = points.at(i).getPosition();
-
-			vector<Point3f> vec; 
-
-			// On change le point 2D en point 3D
-			vec.push_back(Point3f(src.x,src.y,1)); 
+			modifiedPoints.at(i) = (Point) pointTransform(Point2f(points.at(i)), transMat);
+	}
 
-			// On applique une transpos pour avoir la bonne orientation de la matrice avant la multiplication
-			Mat srcMat = Mat(vec).reshape(1).t(); 
-			Mat dstMat = transMat*srcMat; // Faire la multiplication
+	void pointsTransform(const std::vector<KeyPt> &points, const cv::Mat &transMat, std::vector<KeyPt> &modifiedPoints)
+	{
+		// La copie garde la mmoire de modifiedPoints, et points peut tre modifiedPoints
+		modifiedPoints = points;
 
-			// Suite < la multiplication, on obtient un vecteur [a, b, c] o c est diffrent de 1
-			// Il faut normaliser afin de ramener en un vecteur 2D
-			// Pour ce faire, on divise a et b par c -> a = a/c et b = b/c
-			// dstMat.at<float>(0,0) = a,  dstMat.at<float>(1,0) = b  et dstMat.at<float>(2,0) = c
-			dst = (Point) Point2f(dstMat.at<float>(0,0) / dstMat.at<float>(2,0), dstMat.at<float>(1,0) / dstMat.at<float>(2,0)); 
-			points.at(i).setPosition(dst);
-			//std::cout<<dst.x<<" "<<dst.y<<std::endl; 
-			modifiedPoints.push_back(points.at(i));
-		}
-		return modifiedPoints;
+		for (unsigned int i = 0; i < modifiedPoints.size(); ++i)
+			modifiedPoints.at(i).setPosition(Point2f((Point) pointTransform(modifiedPoints.at(i).getPosition(), transMat)));
 	}
 
-	std::vector<std::vector<KeyPt>> pointsTransform(std::vector<std::vector<KeyPt>> points, cv::Mat transMat)
+	void pointsTransform(const std::vector<std::vector<KeyPt>> &points, const cv::Mat &transMat, std::vector<std::vector<KeyPt>> &modifiedPoints)
 	{
-		std::vector<std::vector<KeyPt>> modifiedPoints;
-		Point2f src;
-		Point2f dst;
+		modifiedPoints = points;
 
-		for (unsigned int i = 0; i < points.size(); ++i)
+		for (unsigned int i = 0; i < modifiedPoints.size(); ++i)
 		{
-			for (unsigned int j = 0; j < points.at(i).size(); ++j)
-			{
-				src = points.at(i).at(j).getPosition();
-
-				vector<Point3f> vec; 
+			for (unsigned int j = 0; j < modifiedPoints.at(i).size(); ++j)
+				modifiedPoints.at(i).at(j).setPosition(Point2f((Point) pointTransform(modifiedPoints.at(i).at(j).getPosition(), transMat)));
+		}
+	}
 
-				// On change le point 2D en point 3D
-				vec.push_back(Point3f(src.x,src.y,1)); 
+	cv::Point2f pointTransform(const cv::Point2f &point, const cv::Mat &transMat)
+	{
+		// On multiplie la matrice (float) par le point 3D [x, y, 1], avec des sommes en double comme le
+		// produit de matrices d'OpenCV, sans crer de matrice temporaire.
+		// On obtient un vecteur [a, b, c] o c est diffrent de 1 : on normalise avec a = a/c et b = b/c
+		const float *m0 = transMat.ptr<float>(0), *m1 = transMat.ptr<float>(1), *m2 = transMat.ptr<float>(2);
 
-				// On applique une transpos pour avoir la bonne orientation de la matrice avant la multiplication
-				Mat srcMat = Mat(vec).reshape(1).t(); 
-				Mat dstMat = transMat*srcMat; // Faire la multiplication
+		float a = (float)((double)m0[0]*point.x + (double)m0[1]*point.y + (double)m0[2]);
+		float b = (float)((double)m1[0]*point.x + (double)m1[1]*point.y + (double)m1[2]);
+		float c = (float)((double)m2[0]*point.x + (double)m2[1]*point.y + (double)m2[2]);
 
-				// Suite < la multiplication, on obtient un vecteur [a, b, c] o c est diffrent de 1
-				// Il faut normaliser afin de ramener en un vecteur 2D
-				// Pour ce faire, on divise a et b par c -> a = a/c et b = b/c
-				// dstMat.at<float>(0,0) = a,  dstMat.at<float>(1,0) = b  et dstMat.at<float>(2,0) = c
-				dst = (Point) Point2f(dstMat.at<float>(0,0) / dstMat.at<float>(2,0), dstMat.at<float>(1,0) / dstMat.at<float>(2,0)); 
-				points.at(i).at(j).setPosition(dst);
-				//std::cout<<dst.x<<" "<<dst.y<<std::endl; 
-				
-			}
-			modifiedPoints.push_back(points.at(i));
-		}
-		return modifiedPoints;
+		return Point2f(a / c, b / c);
 	}
 
-	float computeMeanEuclideanError(std::vector<Point> points1, std::vector<Point> points2, unsigned int frameNumber)
+	float computeMeanEuclideanError(const std::vector<Point> &points1, const std::vector<Point> &points2, unsigned int frameNumber)
 	{
 		float result = 0;
 		float diffx;
@@ -504,7 +686,7 @@ namespace Outils
 		return result;
 	}
 
-	float computeMeanEuclideanError(std::vector<KeyPt> points1, std::vector<KeyPt> points2, unsigned int frameNumber)
+	float computeMeanEuclideanError(const std::vector<KeyPt> &points1, const std::vector<KeyPt> &points2, unsigned int frameNumber)
 	{
 		float result = 0;
 		float diffx;
@@ -530,76 +712,99 @@ namespace Outils
 		return result;
 	}
 	
-	void descriptorMatchLSS(slImage3ch im1, slImage3ch im2, std::vector<Point> &points1, std::vector<Point> &points2)
+	// Descripteurs LSS d'un bloc de LSS_NB_POINTS_BLOC points par itration, une ligne par point
+	class LSSDescriptorsBody : public cv::ParallelLoopBody
 	{
-		slWindow g1("AA"), g2("BB");
+	public:
+		LSSDescriptorsBody(const slImage3ch &im, const std::vector<Point> &points, cv::Mat &descriptors)
+		: im_(im), points_(points), descriptors_(descriptors)
+		{
+		}
 
-		g1.show(im1);
-		g2.show(im2);
+		void operator()(const cv::Range &range) const
+		{
+			SelfSimDescriptor ssd;
+			std::vector<float> d;
+			const int debut = range.start * LSS_NB_POINTS_BLOC;
+			const int fin = std::min(range.end * LSS_NB_POINTS_BLOC, (int)points_.size());
+			std::vector<Point> locations(points_.begin() + debut, points_.begin() + fin);
 
-		waitKey();
-		// Initialisation
+			// Un seul appel pour tous les points du bloc (d a un lment de plus  la fin)
+			ssd.compute(im_, d, cv::Size(im_.size().width, im_.size().height), locations);
+
+			std::copy(d.begin(), d.begin() + (fin - debut) * descriptors_.cols, descriptors_.ptr<float>(debut));
+		}
+
+	private:
+		const slImage3ch &im_;
+		const std::vector<Point> &points_;
+		cv::Mat &descriptors_;
+	};
+
+	void computeLSSDescriptors(const slImage3ch &im, const std::vector<Point> &points, cv::Mat &descriptors)
+	{
 		SelfSimDescriptor ssd;
-		std::vector<std::vector<float>> LSSDescriptors1, LSSDescriptors2;
-		std::vector<float> d1, d2;
-		std::vector<Point> vTemp;
-		
-		float distance = 0;
-		// Pour chauqe point cl de l'image 1, on extrait le descripteur LSS
-		for (unsigned int i = 0; i < points1.size(); ++i)
+		const int nbBlocs = (points.size() + LSS_NB_POINTS_BLOC - 1) / LSS_NB_POINTS_BLOC;
+
+		descriptors.create(points.size(), ssd.getDescriptorSize(), CV_32F);
+
+		if (points.empty())
+			return;
+
+		// Les blocs de points sont rpartis entre les threads
+		cv::parallel_for_(cv::Range(0, nbBlocs), LSSDescriptorsBody(im, points, descriptors));
+	}
+
+	void matchLSSDescriptors(const cv::Mat &descriptors1, const cv::Mat &descriptors2, std::vector<int> &indexes)
+	{
+		cv::Mat indices, distances;
+
+		indexes.assign(descriptors1.rows, -1);
+
+		if (descriptors1.empty() || descriptors2.empty())
+			return;
+
+		if (descriptors2.rows < LSS_NB_POINTS_ANN)
 		{
-			vTemp.push_back(points1.at(i));
-			ssd.compute(im1, d1, cv::Size(im1.size().width, im1.size().height), vTemp);
-			
-			LSSDescriptors1.push_back(d1);
-			d1.clear();
-			vTemp.clear();
+			// Distances au carr de toutes les paires (fonctions vectorises d'OpenCV), la plus petite de chaque ligne
+			cv::batchDistance(descriptors1, descriptors2, distances, CV_32F, indices, NORM_L2SQR, 1);
 		}
-		
-		// Pour chauqe point cl de l'image 1, on extrait le descripteur LSS
-		for (unsigned int j = 0; j < points2.size(); ++j)
+		else
 		{
-			vTemp.push_back(points2.at(j));
-			ssd.compute(im2, d2, cv::Size(im2.size().width, im2.size().height), vTemp);
-			
-			LSSDescriptors2.push_back(d2);	
-			d1.clear();
-			vTemp.clear();
+			// Beaucoup de points : index approximatif (kd-tree) sur les descripteurs de la deuxime image
+			cv::flann::Index index(descriptors2, cv::flann::KDTreeIndexParams(4));
+			index.knnSearch(descriptors1, indices, distances, 1, cv::flann::SearchParams(32));
 		}
-		
-		/*slWindow winGraph6("IR"), winGraph7("VISIBLE");
-		winGraph6.show(im1);
-		winGraph7.show(im2);
 
-		waitKey();*/
+		for (int i = 0; i < descriptors1.rows; ++i)
+			indexes.at(i) = indices.at<int>(i, 0);
+	}
+
+	void descriptorMatchLSS(const slImage3ch &im1, const slImage3ch &im2, const std::vector<Point> &points1, std::vector<Point> &points2)
+	{
+		cv::Mat LSSDescriptors1, LSSDescriptors2;
+		std::vector<int> indexes;
+		std::vector<Point> pts2;
 
-		// On fait une copie des points2
-		std::vector<Point> pts2 = points2;
-		
-		// Rinitialiser les points2 pour les rassigner selon les correspondances avec les points1
-		points2.clear();
+		// Descripteurs LSS de tous les points cls de chaque image
+		computeLSSDescriptors(im1, points1, LSSDescriptors1);
+		computeLSSDescriptors(im2, points2, LSSDescriptors2);
 
 		// Pour chaque descripteur des points1, on trouve le match des points2
-		for (int ind1 = 0; ind1 < LSSDescriptors1.size(); ++ind1)
-		{
-			float distMin = 9999.0;
-			float distTemp = 0.0;
-			int indexMin = 0;
+		matchLSSDescriptors(LSSDescriptors1, LSSDescriptors2, indexes);
 
-			for (int ind2 = 0; ind2 < LSSDescriptors2.size(); ++ind2)
-			{
-				distTemp = LSSDescriptorDistance(LSSDescriptors1.at(ind1), LSSDescriptors2.at(ind2));
-				if (distTemp < distMin)
-				{
-					distMin = distTemp;
-					indexMin = ind2;
-				}
-			}
-			points2.push_back(pts2.at(indexMin));
+		// Rassigner les points2 selon les correspondances avec les points1
+		pts2.swap(points2);
+		points2.reserve(indexes.size());
+
+		for (unsigned int i = 0; i < indexes.size(); ++i)
+		{
+			if (indexes.at(i) >= 0)
+				points2.push_back(pts2.at(indexes.at(i)));
 		}
 	}
 
-	float LSSDescriptorDistance(std::vector<float> descriptor1, std::vector<float> descriptor2)
+	float LSSDescriptorDistance(const std::vector<float> &descriptor1, const std::vector<float> &descriptor2)
 	{
 		float diff, result;
 		result = 0;
@@ -869,6 +1074,317 @@ namespace Outils
 		}
 	}
 
+	void convertPolygons(const slContours &contours, const slDce *dce, std::vector<std::vector<KeyPt>> &vecNewKeyPts)
+	{
+		convertPolygons(contours, dce, dce->getResult(), vecNewKeyPts);
+	}
+
+	void convertPolygons(const slContours &contours, const slDce *dce, const slBlobResult &result, std::vector<std::vector<KeyPt>> &vecNewKeyPts)
+	{
+		std::vector<slDceVertex> polygon;
+
+		// Pour chaque contour externe
+		for (slContours::const_iterator contour = contours.begin();
+			!contour.isNull(); contour = contour.next())
+		{
+			if (!result.hasKeyPoints(contour))
+				continue;
+
+			// Analys ici si le blobAnalyzer est paresseux
+			int blob = result.getBlob(contour);
+
+			// Le polygone est dj dans l'ordre du contour
+			dce->getPolygon(result, contour, polygon);
+
+			// Deux sommets  la mme position donnent un seul point cl avec 4 voisins : ce n'est pas un bon blob
+			int nbKeyPoints = result.getGraph().endVertex(blob) - result.getGraph().beginVertex(blob);
+
+			if (!polygon.empty() && nbKeyPoints == (int)polygon.size())
+				vecNewKeyPts.push_back(convert2KeyPt(polygon));
+		}
+	}
+
+	void convertKeyPoints(const slContours &contours, const slBlobAnalyzer *ba, std::vector<std::vector<KeyPt>> &vecNewKeyPts)
+	{
+		convertKeyPoints(contours, ba->getResult(), vecNewKeyPts);
+	}
+
+	void convertKeyPoints(const slContours &contours, const slBlobResult &result, std::vector<std::vector<KeyPt>> &vecNewKeyPts)
+	{
+		const slDce *dce = dynamic_cast<const slDce*>(result.getAnalyzer());
+
+		// Avec DCE, pas besoin de trier les points
+		if (dce != NULL)
+		{
+			convertPolygons(contours, dce, result, vecNewKeyPts);
+		}
+		else
+		{
+			std::vector<slKeyPoints> keys = extractKeysPoints(contours, result);
+			convertAndSortKeyPoints(keys, vecNewKeyPts);
+		}
+	}
+
+	// Blob suivant  remplir : les blobs dj dans le vecteur sont rutiliss avant d'en ajouter
+	static KeyPtBlob& nextBlob(std::vector<KeyPtBlob> &vecBlobs, unsigned int &nbBlobs)
+	{
+		if (nbBlobs == vecBlobs.size())
+			vecBlobs.resize(nbBlobs + 1);
+
+		return vecBlobs.at(nbBlobs++);
+	}
+
+	// Les blobs en trop (d'une frame prcdente) sont vids mais gardent leur mmoire
+	static void clearBlobs(std::vector<KeyPtBlob> &vecBlobs, unsigned int nbBlobs)
+	{
+		for (unsigned int i = nbBlobs; i < vecBlobs.size(); ++i)
+			vecBlobs.at(i).clear();
+	}
+
+	void convertPolygons(const slContours &contours, const slDce *dce, const slBlobResult &result, std::vector<KeyPtBlob> &vecBlobs)
+	{
+		std::vector<slDceVertex> polygon;
+		unsigned int nbBlobs = 0;
+
+		// Pour chaque contour externe
+		for (slContours::const_iterator contour = contours.begin();
+			!contour.isNull(); contour = contour.next())
+		{
+			if (!result.hasKeyPoints(contour))
+				continue;
+
+			// Analys ici si le blobAnalyzer est paresseux
+			int blob = result.getBlob(contour);
+
+			// Le polygone est dj dans l'ordre du contour
+			dce->getPolygon(result, contour, polygon);
+
+			// Deux sommets  la mme position donnent un seul point cl avec 4 voisins : ce n'est pas un bon blob
+			int nbKeyPoints = result.getGraph().endVertex(blob) - result.getGraph().beginVertex(blob);
+
+			if (!polygon.empty() && nbKeyPoints == (int)polygon.size())
+				convert2KeyPt(polygon, nextBlob(vecBlobs, nbBlobs));
+		}
+
+		clearBlobs(vecBlobs, nbBlobs);
+	}
+
+	void convertKeyPoints(const slContours &contours, const slBlobResult &result, std::vector<KeyPtBlob> &vecBlobs)
+	{
+		const slDce *dce = dynamic_cast<const slDce*>(result.getAnalyzer());
+
+		// Avec DCE, les sommets sont directement crits dans les blobs
+		if (dce != NULL)
+		{
+			convertPolygons(contours, dce, result, vecBlobs);
+		}
+		else
+		{
+			std::vector<std::vector<KeyPt>> vecNewKeyPts;
+			unsigned int nbBlobs = 0;
+
+			convertKeyPoints(contours, result, vecNewKeyPts);
+
+			for (unsigned int i = 0; i < vecNewKeyPts.size(); ++i)
+				nextBlob(vecBlobs, nbBlobs).assign(vecNewKeyPts.at(i));
+
+			clearBlobs(vecBlobs, nbBlobs);
+		}
+	}
+
+	void convert2KeyPt(const std::vector<slDceVertex> &polygon, KeyPtBlob &blob)
+	{
+		const int total = polygon.size();
+
+		blob.clear();
+
+		if (total == 0)
+			return;
+
+		// Le premier point est le plus haut (puis le plus  gauche), comme avec sortKeyPoints()
+		int first = 0;
+
+		for (int i = 1; i < total; ++i)
+		{
+			if (CvPoint2fLessThan()(Point2f(polygon.at(i).position), Point2f(polygon.at(first).position)))
+				first = i;
+		}
+
+		// Les tableaux du blob et ses tampons gardent leur mmoire
+		blob.resize(total);
+		blob.dx.resize(total);
+		blob.dy.resize(total);
+
+		float *x = &blob.x[0], *y = &blob.y[0];
+		float *dx = &blob.dx[0], *dy = &blob.dy[0];		// Vecteurs vers le point suivant
+		float *distPrec = &blob.distancePrec[0], *distSuiv = &blob.distanceSuiv[0];
+		float *angle = &blob.angle[0];
+		int *convexite = &blob.convexite[0];
+
+		for (int i = 0; i < total; ++i)
+		{
+			const cv::Point &position = polygon[first + i < total ? first + i : first + i - total].position;
+
+			x[i] = (float)position.x;
+			y[i] = (float)position.y;
+		}
+
+		// Centrode et boundingbox du blob, calculs une seule fois comme dans convert2KeyPt()
+		blob.boundingBox.first = Point2f(x[0], y[0]);
+		blob.boundingBox.second = blob.boundingBox.first;
+
+		for (int i = 0; i < total; ++i)
+		{
+			blob.centroid.x += x[i];
+			blob.centroid.y += y[i];
+
+			blob.boundingBox.first.x = std::min(blob.boundingBox.first.x, x[i]);
+			blob.boundingBox.first.y = std::min(blob.boundingBox.first.y, y[i]);
+			blob.boundingBox.second.x = std::max(blob.boundingBox.second.x, x[i]);
+			blob.boundingBox.second.y = std::max(blob.boundingBox.second.y, y[i]);
+		}
+
+		blob.centroid.x = blob.centroid.x/total;
+		blob.centroid.y = blob.centroid.y/total;
+
+		// Vecteur de chaque point vers le suivant : c'est aussi le vecteur du prcdent vers le point,
+		// donc les deux voisins d'un point n'ont besoin que d'un seul tableau de diffrences
+		for (int i = 0; i < total - 1; ++i)
+		{
+			dx[i] = x[i + 1] - x[i];
+			dy[i] = y[i + 1] - y[i];
+		}
+
+		dx[total - 1] = x[0] - x[total - 1];
+		dy[total - 1] = y[0] - y[total - 1];
+
+		// Convexit : signe du produit vectoriel (point - prcdent) x (suivant - point), comme KeyPt::calculerConvexite()
+		convexite[0] = (dx[total - 1] * dy[0] - dy[total - 1] * dx[0] > 0 ? CONCAVE : CONVEXE);
+
+		for (int i = 1; i < total; ++i)
+			convexite[i] = (dx[i - 1] * dy[i] - dy[i - 1] * dx[i] > 0 ? CONCAVE : CONVEXE);
+
+		// Distances au voisin suivant (boucle simple, vectorise par le compilateur), puis au voisin prcdent par dcalage
+		for (int i = 0; i < total; ++i)
+			distSuiv[i] = sqrt((dx[i]*dx[i]) + (dy[i]*dy[i]));
+
+		distPrec[0] = distSuiv[total - 1];
+
+		for (int i = 1; i < total; ++i)
+			distPrec[i] = distSuiv[i - 1];
+
+		// Loi des cosinus, avec la distance entre les deux voisins, comme KeyPt::calculerAngle()
+		for (int i = 0; i < total; ++i)
+		{
+			const int prec = (i > 0 ? i - 1 : total - 1);
+			const int suiv = (i < total - 1 ? i + 1 : 0);
+			const float vx = x[prec] - x[suiv];
+			const float vy = y[prec] - y[suiv];
+			const float distanceEntreVoisins = sqrt((vx*vx) + (vy*vy));
+
+			angle[i] = (distPrec[i]*distPrec[i] + distSuiv[i]*distSuiv[i] - distanceEntreVoisins * distanceEntreVoisins) / (2 * distPrec[i]*distSuiv[i]);
+		}
+
+		// Conversion de radian ver degr
+		for (int i = 0; i < total; ++i)
+			angle[i] = acos(angle[i])*(float)180/(float)3.14159265;
+
+		blob.computeArea();
+	}
+
+	std::vector<KeyPt> convert2KeyPt(const std::vector<slDceVertex> &polygon)
+	{
+		std::vector<KeyPt> keyPts;
+		std::vector<cv::Point2f> pointsVoisins(2);
+		std::vector<float> distancesVoisins(2);
+		KeyPtBlob blob;
+		KeyPt key;
+
+		// Tous les calculs sont faits sur le blob, puis copis dans les KeyPt
+		convert2KeyPt(polygon, blob);
+
+		const unsigned int total = blob.size();
+		keyPts.reserve(total);
+
+		for (unsigned int i = 0; i < total; ++i)
+		{
+			key.setBoundingBox(blob.boundingBox);
+			key.setCentroid(blob.centroid);							// Ajout du centroid du blob
+			key.setPosition(blob.getPosition(i));					// Position du point
+
+			// Les 2 voisins (prcdent et suivant) du point
+			pointsVoisins.at(0) = blob.getPosition((i + total - 1) % total);
+			pointsVoisins.at(1) = blob.getPosition((i + 1) % total);
+			key.setVoisins(pointsVoisins);
+
+			distancesVoisins.at(0) = blob.distancePrec[i];
+			distancesVoisins.at(1) = blob.distanceSuiv[i];
+			key.setDistancesVoisins(distancesVoisins);
+
+			key.setConvexite(blob.convexite[i]);
+			key.setAngle(blob.angle[i]);
+
+			// On ajoute le point cr dans le vecteur de points
+			keyPts.push_back(key);
+			key.clear();
+		}
+
+		return keyPts;
+	}
+
+	void computeDescriptors(const slImage1ch &fg, const cv::DescriptorExtractor &extractor, std::vector<KeyPtBlob> &vecBlobs)
+	{
+		DescriptorBuffers buffers;
+
+		computeDescriptors(fg, extractor, buffers, vecBlobs);
+	}
+
+	void computeDescriptors(const slImage1ch &fg, const cv::DescriptorExtractor &extractor, DescriptorBuffers &buffers, std::vector<KeyPtBlob> &vecBlobs)
+	{
+		// Les tampons de l'appelant gardent leur mmoire d'une frame  l'autre
+		std::vector<cv::KeyPoint> &keyPoints = buffers.keyPoints;
+		std::vector<std::pair<int, int>> &sommets = buffers.sommets;
+		cv::Mat &descriptors = buffers.descriptors;
+
+		keyPoints.clear();
+		sommets.clear();
+
+		// Un KeyPoint par sommet de tous les blobs, class_id retrouve le sommet
+		for (unsigned int b = 0; b < vecBlobs.size(); ++b)
+		{
+			KeyPtBlob &blob = vecBlobs.at(b);
+
+			blob.hasDescriptor.assign(blob.size(), 0);
+
+			for (unsigned int i = 0; i < blob.size(); ++i)
+			{
+				keyPoints.push_back(cv::KeyPoint(blob.getPosition(i), TAILLE_DESCRIPTEUR, -1, 0, 0, sommets.size()));
+				sommets.push_back(std::make_pair(b, i));
+			}
+		}
+
+		if (keyPoints.empty())
+			return;
+
+		// L'extracteur enlve les KeyPoint trop prs du bord de l'image : ces sommets n'ont pas de descripteur
+		extractor.compute(fg, keyPoints, descriptors);
+
+		if (descriptors.empty())
+			return;
+
+		for (unsigned int b = 0; b < vecBlobs.size(); ++b)
+			vecBlobs.at(b).descriptors.create(vecBlobs.at(b).size(), descriptors.cols, descriptors.type());
+
+		for (unsigned int k = 0; k < keyPoints.size(); ++k)
+		{
+			KeyPtBlob &blob = vecBlobs.at(sommets.at(keyPoints.at(k).class_id).first);
+			int i = sommets.at(keyPoints.at(k).class_id).second;
+
+			descriptors.row(k).copyTo(blob.descriptors.row(i));
+			blob.hasDescriptor.at(i) = 1;
+		}
+	}
+
 	float rad2Deg(float radian)
 	{
 		return radian*180/3.14159265;
@@ -879,12 +1395,21 @@ namespace Outils
 		return degree*3.14159265/180;
 	}
 
-	std::vector<cv::Point2f> getCentroid(std::vector<std::vector<KeyPt>> keyPoints)
+	std::vector<cv::Point2f> getCentroid(const std::vector<std::vector<KeyPt>> &keyPoints)
 	{
-		// Initialisation
 		std::vector<cv::Point2f> centroids;
+
+		getCentroid(keyPoints, centroids);
+		return centroids;
+	}
+
+	void getCentroid(const std::vector<std::vector<KeyPt>> &keyPoints, std::vector<cv::Point2f> &centroids)
+	{
+		// Initialisation
 		cv::Point2f centroid;
 
+		centroids.clear();
+
 		// Pour chaque blob
 		for (unsigned int i = 0; i < keyPoints.size(); ++i)
 		{
@@ -902,11 +1427,9 @@ namespace Outils
 			// On ajoute le centrode dans le vecteur;
 			centroids.push_back(centroid);
 		}
-
-		return centroids;
 	}
 
-	cv::Point2f getCentroid(std::vector<KeyPt> keyPoints)
+	cv::Point2f getCentroid(const std::vector<KeyPt> &keyPoints)
 	{
 		// Initialisation
 		cv::Point2f centroid;
@@ -967,203 +1490,455 @@ namespace Outils
 		return angle*(float)180/(float)3.14159265;
 	}
 
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2)
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2)
 	{
+		// Une grille par blob de la deuxime image, construite une seule fois
+		std::vector<KeyPtGrid> grids2(vecKeyPoints2.size());
+
+		for (unsigned int j = 0; j < vecKeyPoints2.size(); ++j)
+			grids2.at(j).build(vecKeyPoints2.at(j));
+
 		// Pour chaque blob de la premire image
 		for (unsigned int i = 0; i < vecKeyPoints1.size(); ++i)
 		{
 			// Pour chaque blob de la deuxime image
 			for (unsigned int j = 0; j < vecKeyPoints2.size(); ++j)
 			{
-				matchPoints(vecKeyPoints1.at(i), vecKeyPoints2.at(j), matchedPoints1, matchedPoints2);
+				matchPoints(vecKeyPoints1.at(i), grids2.at(j), matchedPoints1, matchedPoints2);
 			}
 		}
 	}
 
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2)
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2)
 	{
-		std::vector<KeyPt> matchedPts1, matchedPts2, keyPoints2;
+		KeyPtGrid grid2;
 
-		for (unsigned int it = 0; it < vecKeyPoints2.size(); ++it)
-		{
-			keyPoints2.insert(keyPoints2.begin(), vecKeyPoints2.at(it).begin(), vecKeyPoints2.at(it).end());
-		}
+		matchBlobs(vecKeyPoints1, vecKeyPoints2, grid2, matchedPoints1, matchedPoints2);
+	}
+
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, KeyPtGrid &grid2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2)
+	{
+		// Grille sur tous les points de la deuxime image, rutilise pour chaque blob de la premire
+		grid2.build(vecKeyPoints2);
 
 		// Pour chaque blob de la premire image
 		for (unsigned int i = 0; i < vecKeyPoints1.size(); ++i)
 		{
-			matchPoints(vecKeyPoints1.at(i), keyPoints2, matchedPts1, matchedPts2);
-			
 			// On ajoute un vecteur de matches pour le blob i de la premire image
-			matchedPoints1.push_back(matchedPts1);
-			matchedPoints2.push_back(matchedPts2);
+			matchedPoints1.resize(matchedPoints1.size() + 1);
+			matchedPoints2.resize(matchedPoints2.size() + 1);
 
-			matchedPts1.clear();
-			matchedPts2.clear();
+			matchPoints(vecKeyPoints1.at(i), grid2, matchedPoints1.back(), matchedPoints2.back());
 		}
 	}
 
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2)
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, KeyPtGrid &grid2, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2)
 	{
+		matchBlobs(vecBlobs1, vecBlobs2, cv::Mat(), RADIUS_MIN, grid2, matchedPoints1, matchedPoints2);
+	}
+
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, KeyPtGrid &grid2, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2)
+	{
+		BlobMatchBuffers buffers;
+
+		matchBlobs(vecBlobs1, vecBlobs2, transMat, radius, grid2, buffers, matchedPoints1, matchedPoints2);
+	}
+
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, KeyPtGrid &grid2, BlobMatchBuffers &buffers, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2)
+	{
+		const std::vector<std::vector<int>> &candidates = buffers.candidates;
+		std::vector<unsigned char> &blobMask = buffers.blobMask;
+
+		// Sans homographie, on revient au rayon complet
+		if (transMat.empty())
+			radius = RADIUS_MIN;
+
+		// Paires de blobs plausibles, avant de comparer les points
+		matchBlobCandidates(vecBlobs1, vecBlobs2, transMat, radius, buffers);
+		blobMask.assign(vecBlobs2.size(), 0);
+
+		// Grille sur tous les points de la deuxime image, rutilise pour chaque blob de la premire
+		// (des cellules de la taille du rayon de recherche)
+		grid2.build(vecBlobs2, radius);
+
+		// Un vecteur de matches par blob de la premire image : les vecteurs d'une frame prcdente
+		// gardent leur mmoire (ceux en trop restent vides)
+		if (matchedPoints1.size() < vecBlobs1.size())
+		{
+			matchedPoints1.resize(vecBlobs1.size());
+			matchedPoints2.resize(vecBlobs1.size());
+		}
+
+		for (unsigned int i = 0; i < matchedPoints1.size(); ++i)
+		{
+			matchedPoints1.at(i).clear();
+			matchedPoints2.at(i).clear();
+		}
+
 		// Pour chaque blob de la premire image
-		for (unsigned int i = 0; i < vecKeyPoints1.size(); ++i)
+		for (unsigned int i = 0; i < vecBlobs1.size(); ++i)
 		{
-			// Pour chaque blob de la deuxime image
-			for (unsigned int j = 0; j < vecKeyPoints2.size(); ++j)
-			{
-				matchPoints(vecKeyPoints1.at(i), vecKeyPoints2.at(j), matchedPoints1, matchedPoints2);
-			}
+			// Aucun blob plausible : pas de matches
+			if (candidates.at(i).empty())
+				continue;
+
+			for (unsigned int c = 0; c < candidates.at(i).size(); ++c)
+				blobMask.at(candidates.at(i).at(c)) = 1;
+
+			matchPoints(vecBlobs1.at(i), grid2, transMat, radius, matchedPoints1.at(i), matchedPoints2.at(i), &blobMask);
+
+			for (unsigned int c = 0; c < candidates.at(i).size(); ++c)
+				blobMask.at(candidates.at(i).at(c)) = 0;
 		}
 	}
 
-	void matchPoints(std::vector<KeyPt> keyPoints1, std::vector<KeyPt> keyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2)
+	static bool xMinLessThan(const BlobBox &box1, const BlobBox &box2)
 	{
-		float distance;
-		float erreurAngle;
+		return box1.xMin < box2.xMin;
+	}
 
-		std::vector<int> index;
-		std::vector<float> distances;
-		std::vector<float> erreurAngles;
+	// Les deux blobs d'une paire dont les boundingbox se chevauchent en X peuvent-ils se correspondre ?
+	static bool plausibleBlobs(const BlobBox &box1, const BlobBox &box2)
+	{
+		// Les boundingbox doivent aussi se chevaucher en Y
+		if (box1.yMax < box2.yMin || box2.yMax < box1.yMin)
+			return false;
 
+		// Le centrode d'un des blobs doit tre dans le boundingbox de l'autre
+		bool centroid1In2 = (box1.centroid.x >= box2.xMin && box1.centroid.x <= box2.xMax && box1.centroid.y >= box2.yMin && box1.centroid.y <= box2.yMax);
+		bool centroid2In1 = (box2.centroid.x >= box1.xMin && box2.centroid.x <= box1.xMax && box2.centroid.y >= box1.yMin && box2.centroid.y <= box1.yMax);
 
-		// Pour chaque point du premier blob
-		for (unsigned int i = 0; i < keyPoints1.size(); ++i)
+		if (!centroid1In2 && !centroid2In1)
+			return false;
+
+		// Aires du mme ordre (sauf pour les blobs dgnrs)
+		if (box1.area > 0 && box2.area > 0)
+			return (box1.area <= RATIO_AIRE_MAX * box2.area && box2.area <= RATIO_AIRE_MAX * box1.area);
+
+		return true;
+	}
+
+	void matchBlobCandidates(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, std::vector<std::vector<int>> &candidates)
+	{
+		BlobMatchBuffers buffers;
+
+		matchBlobCandidates(vecBlobs1, vecBlobs2, transMat, radius, buffers);
+
+		candidates.swap(buffers.candidates);
+		candidates.resize(vecBlobs1.size());
+	}
+
+	void matchBlobCandidates(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, BlobMatchBuffers &buffers)
+	{
+		std::vector<BlobBox> &boxes = buffers.boxes;
+		std::vector<std::vector<int>> &candidates = buffers.candidates;
+		std::vector<int> &actifs1 = buffers.actifs1, &actifs2 = buffers.actifs2;
+		BlobBox box;
+
+		// Les vecteurs gardent leur mmoire d'un appel  l'autre
+		boxes.clear();
+		actifs1.clear();
+		actifs2.clear();
+
+		if (candidates.size() < vecBlobs1.size())
+			candidates.resize(vecBlobs1.size());
+
+		for (unsigned int i = 0; i < candidates.size(); ++i)
+			candidates.at(i).clear();
+
+		// Blobs de la premire image : boundingbox (transform par l'homographie) agrandi du rayon de recherche
+		for (unsigned int i = 0; i < vecBlobs1.size(); ++i)
 		{
-			// Pour chaque point du deuxime blob
-			for (unsigned int j = 0; j < keyPoints2.size(); ++j)
+			const KeyPtBlob &blob = vecBlobs1.at(i);
+
+			if (blob.empty())
+				continue;
+
+			box.xMin = blob.boundingBox.first.x;
+			box.yMin = blob.boundingBox.first.y;
+			box.xMax = blob.boundingBox.second.x;
+			box.yMax = blob.boundingBox.second.y;
+			box.centroid = blob.centroid;
+			box.area = blob.area;
+
+			if (!transMat.empty())
 			{
-				distance = computeDistance(keyPoints1.at(i).getPosition(), keyPoints2.at(j).getPosition());
-				
-				// Si les points ne sont pas trop loign
-				if (distance <= RADIUS_MIN)
+				// Les points transforms sont dans le quadrilatre des coins transforms
+				cv::Point2f coins[4] = {
+					pointTransform(Point2f(box.xMin, box.yMin), transMat), pointTransform(Point2f(box.xMax, box.yMin), transMat),
+					pointTransform(Point2f(box.xMax, box.yMax), transMat), pointTransform(Point2f(box.xMin, box.yMax), transMat) };
+				float aireCoins = 0;
+
+				box.xMin = box.xMax = coins[0].x;
+				box.yMin = box.yMax = coins[0].y;
+
+				for (int c = 0; c < 4; ++c)
 				{
-					// Si les deux points ne sont pas dans des secteurs diagonalement opposs
-					//if (keyPoints1.at(i).getSecteur() + keyPoints2.at(j).getSecteur() != 0)
-					//{
-						// Si les deux points ont la mme convexit
-						if (keyPoints1.at(i).getConvexite() == keyPoints2.at(j).getConvexite())
-						{
-							//erreurAngle = abs(keyPoints1.at(i).getAngle() - keyPoints2.at(j).getAngle());
-							// Si la diffrence entre l'amplitude des angle est plus faible qu'un certain nombre de degr
-							if (erreurAngle < ERREUR_ANGLE_MAX	)
-							{
-								index.push_back(j);
-								distances.push_back(distance);
-								erreurAngles.push_back(erreurAngle);
-							}
-						}
-					//}
+					box.xMin = std::min(box.xMin, coins[c].x);
+					box.yMin = std::min(box.yMin, coins[c].y);
+					box.xMax = std::max(box.xMax, coins[c].x);
+					box.yMax = std::max(box.yMax, coins[c].y);
+					aireCoins += coins[c].x * coins[(c + 1) % 4].y - coins[(c + 1) % 4].x * coins[c].y;
 				}
+
+				// L'aire change comme celle du boundingbox
+				float aireBox = (blob.boundingBox.second.x - blob.boundingBox.first.x) * (blob.boundingBox.second.y - blob.boundingBox.first.y);
+
+				box.centroid = pointTransform(blob.centroid, transMat);
+				box.area = (aireBox > 0 ? blob.area * fabs(aireCoins) / 2 / aireBox : blob.area);
 			}
 
-			// S'il y a plus qu'un match pour un point i
-			if (index.size() > 1)
+			box.xMin -= radius;
+			box.yMin -= radius;
+			box.xMax += radius;
+			box.yMax += radius;
+			box.index = i;
+			box.premier = true;
+			boxes.push_back(box);
+		}
+
+		// Blobs de la deuxime image
+		for (unsigned int j = 0; j < vecBlobs2.size(); ++j)
+		{
+			const KeyPtBlob &blob = vecBlobs2.at(j);
+
+			if (blob.empty())
+				continue;
+
+			box.xMin = blob.boundingBox.first.x;
+			box.yMin = blob.boundingBox.first.y;
+			box.xMax = blob.boundingBox.second.x;
+			box.yMax = blob.boundingBox.second.y;
+			box.centroid = blob.centroid;
+			box.area = blob.area;
+			box.index = j;
+			box.premier = false;
+			boxes.push_back(box);
+		}
+
+		// Balayage en X : chaque boundingbox est compar aux boundingbox actifs de l'autre image
+		std::sort(boxes.begin(), boxes.end(), xMinLessThan);
+
+		for (unsigned int b = 0; b < boxes.size(); ++b)
+		{
+			const BlobBox &courant = boxes.at(b);
+			std::vector<int> &autres = (courant.premier ? actifs2 : actifs1);
+			std::vector<int> &memes = (courant.premier ? actifs1 : actifs2);
+			unsigned int nbAutres = 0;
+
+			// On retire les boundingbox qui finissent avant celui-ci
+			for (unsigned int a = 0; a < autres.size(); ++a)
 			{
-				unsigned int ind = 0;
-				float score = 0;
-				float scoreMin = 1000;
-				for (unsigned int k = 0; k < index.size(); ++k)
-				{
-					score = (distances.at(k)/RADIUS_MIN) * 2 + (erreurAngles.at(k)/ERREUR_ANGLE_MAX);
-					if (score < scoreMin)
-					{
-						scoreMin = score;
-						ind = index.at(k);
-					}
-				}
+				const BlobBox &autre = boxes.at(autres.at(a));
+
+				if (autre.xMax < courant.xMin)
+					continue;
 
-				matchedPoints1.push_back(keyPoints1.at(i).getPosition());
-				matchedPoints2.push_back(keyPoints2.at(ind).getPosition());
+				autres.at(nbAutres++) = autres.at(a);
+
+				if (courant.premier && plausibleBlobs(courant, autre))
+					candidates.at(courant.index).push_back(autre.index);
+				else if (!courant.premier && plausibleBlobs(autre, courant))
+					candidates.at(autre.index).push_back(courant.index);
 			}
 
-			else if (index.size() == 1)
+			autres.resize(nbAutres);
+			memes.push_back(b);
+		}
+
+		// Blobs candidats dans l'ordre
+		for (unsigned int i = 0; i < vecBlobs1.size(); ++i)
+			std::sort(candidates.at(i).begin(), candidates.at(i).end());
+	}
+
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2)
+	{
+		// Une grille par blob de la deuxime image, construite une seule fois
+		std::vector<KeyPtGrid> grids2(vecKeyPoints2.size());
+
+		for (unsigned int j = 0; j < vecKeyPoints2.size(); ++j)
+			grids2.at(j).build(vecKeyPoints2.at(j));
+
+		// Pour chaque blob de la premire image
+		for (unsigned int i = 0; i < vecKeyPoints1.size(); ++i)
+		{
+			// Pour chaque blob de la deuxime image
+			for (unsigned int j = 0; j < vecKeyPoints2.size(); ++j)
 			{
-				matchedPoints1.push_back(keyPoints1.at(i).getPosition());
-				matchedPoints2.push_back(keyPoints2.at(index.at(0)).getPosition());
+				matchPoints(vecKeyPoints1.at(i), grids2.at(j), matchedPoints1, matchedPoints2);
 			}
-
-			// Rinitialisation
-			index.clear();
-			distances.clear();
-			erreurAngles.clear();
 		}
 	}
 
-	void matchPoints(std::vector<KeyPt> keyPoints1, std::vector<KeyPt> keyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2)
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const std::vector<KeyPt> &keyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2)
+	{
+		KeyPtGrid grid2(keyPoints2);
+
+		matchPoints(keyPoints1, grid2, matchedPoints1, matchedPoints2);
+	}
+
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const std::vector<KeyPt> &keyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2)
+	{
+		KeyPtGrid grid2(keyPoints2);
+
+		matchPoints(keyPoints1, grid2, matchedPoints1, matchedPoints2);
+	}
+
+	// Indice dans grid2 du meilleur match d'un point  moins de radius de position1, -1 s'il n'y en a pas
+	// (avec blobMask, seulement parmi les blobs de grid2 qui ont un masque non nul ;
+	// avec descriptor1, seulement parmi les points dont le descripteur est  moins de HAMMING_MAX)
+	static int findMatch(const cv::Point2f &position1, int convexite1, float angle1, const KeyPtGrid &grid2, bool compareAngles,
+		float radius = RADIUS_MIN, const std::vector<unsigned char> *blobMask = NULL, const unsigned char *descriptor1 = NULL)
 	{
 		float distance;
-		float erreurAngle;
+		float erreurAngle = 0;
+		float score;
+		float scoreMin = 1000;
+		int ind = -1;
+		int colMin, colMax, rowMin, rowMax;
 
-		std::vector<int> index;
-		std::vector<float> distances;
-		std::vector<float> erreurAngles;
+		// Cellules voisines de la grille (marge d'un pixel pour les arrondis)
+		grid2.getCells(position1, radius + 1, colMin, colMax, rowMin, rowMax);
 
-		// Pour chaque point du premier blob
-		for (unsigned int i = 0; i < keyPoints1.size(); ++i)
+		for (int row = rowMin; row <= rowMax; ++row)
 		{
-			// Pour chaque point du deuxime blob
-			for (unsigned int j = 0; j < keyPoints2.size(); ++j)
+			for (int col = colMin; col <= colMax; ++col)
 			{
-				distance = computeDistance(keyPoints1.at(i).getPosition(), keyPoints2.at(j).getPosition());
-				
-				// Si les points ne sont pas trop loign
-				if (distance <= RADIUS_MIN)
+				// Pour chaque point du deuxime blob dans la cellule
+				for (const int *it = grid2.beginCell(col, row); it != grid2.endCell(col, row); ++it)
 				{
-					// Si les deux points ne sont pas dans des secteurs diagonalement opposs
-					//if (keyPoints1.at(i).getSecteur() + keyPoints2.at(j).getSecteur() != 0)
-					//{
-						// Si les deux points ont la mme convexit
-						if (keyPoints1.at(i).getConvexite() == keyPoints2.at(j).getConvexite())
+					distance = computeDistance(position1, grid2.position(*it));
+
+					// Si les points ne sont pas trop loign, et si les deux points ont la mme convexit
+					if (distance > radius || convexite1 != grid2.convexite(*it))
+						continue;
+
+					if (blobMask != NULL && !(*blobMask)[grid2.blobIndex(*it)])
+						continue;
+
+					// Descripteurs trop diffrents (si les deux points en ont un)
+					if (descriptor1 != NULL && grid2.descriptor(*it) != NULL &&
+						cv::normHamming(descriptor1, grid2.descriptor(*it), grid2.descriptorSize()) > HAMMING_MAX)
+						continue;
+
+					if (compareAngles)
+						erreurAngle = abs(angle1 - grid2.angle(*it));
+
+					// Si la diffrence entre l'amplitude des angle est plus faible que 45 degr
+					if (erreurAngle < ERREUR_ANGLE_MAX)
+					{
+						// Meilleur score, le plus petit indice en cas d'galit comme avec le parcours complet des points
+						score = (distance/radius) * 2 + (erreurAngle/ERREUR_ANGLE_MAX);
+
+						if (ind < 0 || score < scoreMin || (score == scoreMin && *it < ind))
 						{
-							erreurAngle = abs(keyPoints1.at(i).getAngle() - keyPoints2.at(j).getAngle());
-
-							// Si la diffrence entre l'amplitude des angle est plus faible que 45 degr
-							if (erreurAngle < ERREUR_ANGLE_MAX	)
-							{
-								index.push_back(j);
-								distances.push_back(distance);
-								erreurAngles.push_back(erreurAngle);						
-							}
+							scoreMin = score;
+							ind = *it;
 						}
-					//}
+					}
 				}
 			}
+		}
+
+		return ind;
+	}
 
-			// S'il y a plus qu'un match pour un point i
-			if (index.size() > 1)
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const KeyPtGrid &grid2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2)
+	{
+		// Pour chaque point du premier blob
+		for (unsigned int i = 0; i < keyPoints1.size(); ++i)
+		{
+			const KeyPt &keyPt1 = keyPoints1.at(i);
+
+			// L'erreur d'angle n'est pas compare pour les matches en Point
+			int ind = findMatch(keyPt1.getPosition(), keyPt1.getConvexite(), keyPt1.getAngle(), grid2, false);
+
+			if (ind >= 0)
 			{
-				unsigned int ind = 0;
-				float score = 0;
-				float scoreMin = 1000;
-				for (unsigned int k = 0; k < index.size(); ++k)
-				{
-					score = (distances.at(k)/RADIUS_MIN) * 2 + (erreurAngles.at(k)/ERREUR_ANGLE_MAX);
-					if (score < scoreMin)
-					{
-						scoreMin = score;
-						ind = index.at(k);
-					}
-				}
+				matchedPoints1.push_back(keyPt1.getPosition());
+				matchedPoints2.push_back(grid2.point(ind).getPosition());
+			}
+		}
+	}
 
-				matchedPoints1.push_back(keyPoints1.at(i));
-				matchedPoints2.push_back(keyPoints2.at(ind));
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const KeyPtGrid &grid2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2)
+	{
+		// Pour chaque point du premier blob
+		for (unsigned int i = 0; i < keyPoints1.size(); ++i)
+		{
+			const KeyPt &keyPt1 = keyPoints1.at(i);
+			int ind = findMatch(keyPt1.getPosition(), keyPt1.getConvexite(), keyPt1.getAngle(), grid2, true);
+
+			if (ind >= 0)
+			{
+				matchedPoints1.push_back(keyPt1);
+				matchedPoints2.push_back(grid2.point(ind));
 			}
+		}
+	}
+
+	void matchPoints(const KeyPtBlob &blob1, const KeyPtGrid &grid2, const cv::Mat &transMat, float radius, std::vector<KeyPtVertex> &matchedPoints1, std::vector<KeyPtVertex> &matchedPoints2, const std::vector<unsigned char> *blobMask)
+	{
+		// Sans homographie, recherche autour de la position du point dans tout le rayon RADIUS_MIN
+		if (transMat.empty())
+			radius = RADIUS_MIN;
 
-			else if (index.size() == 1)
+		// Pour chaque point du premier blob, recherche autour de la position (prdite) dans la deuxime image
+		for (unsigned int i = 0; i < blob1.size(); ++i)
+		{
+			cv::Point2f position1 = (transMat.empty() ? blob1.getPosition(i) : pointTransform(blob1.getPosition(i), transMat));
+			int ind = findMatch(position1, blob1.convexite[i], blob1.angle[i], grid2, true, radius, blobMask, blob1.getDescriptor(i));
+
+			if (ind >= 0)
 			{
-				matchedPoints1.push_back(keyPoints1.at(i));
-				matchedPoints2.push_back(keyPoints2.at(index.at(0)));
+				matchedPoints1.push_back(blob1.getVertex(i));
+				matchedPoints2.push_back(grid2.vertex(ind));
 			}
+		}
+	}
 
-			
-			// Rinitialisation
-			index.clear();
-			distances.clear();
-			erreurAngles.clear();
+	float computeGateRadius(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, const cv::Mat &transMat)
+	{
+		RansacBuffers buffers;
+
+		return computeGateRadius(points1, points2, transMat, buffers);
+	}
+
+	float computeGateRadius(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, const cv::Mat &transMat, RansacBuffers &buffers)
+	{
+		if (transMat.empty() || points1.empty() || points1.size() != points2.size())
+			return RADIUS_MIN;
+
+		// Erreur de chaque match avec l'homographie : distance entre le point transform et son match
+		std::vector<float> &erreurs = buffers.erreurs;
+		erreurs.resize(points1.size());
+
+		for (unsigned int i = 0; i < points1.size(); ++i)
+			erreurs.at(i) = computeDistance(pointTransform(points1.at(i).position, transMat), points2.at(i).position);
+
+		// L'erreur mdiane ne dpend pas des mauvais matches (moins de la moiti)
+		std::nth_element(erreurs.begin(), erreurs.begin() + erreurs.size()/2, erreurs.end());
+		float radius = FACTEUR_RAYON_PREDIT * erreurs.at(erreurs.size()/2);
+
+		return std::min(std::max(radius, (float)RADIUS_PREDIT_MIN), (float)RADIUS_MIN);
+	}
+
+	void matchPoints(const KeyPtBlob &blob1, const KeyPtGrid &grid2, std::vector<KeyPtVertex> &matchedPoints1, std::vector<KeyPtVertex> &matchedPoints2)
+	{
+		// Pour chaque point du premier blob
+		for (unsigned int i = 0; i < blob1.size(); ++i)
+		{
+			int ind = findMatch(blob1.getPosition(i), blob1.convexite[i], blob1.angle[i], grid2, true, RADIUS_MIN, NULL, blob1.getDescriptor(i));
+
+			if (ind >= 0)
+			{
+				matchedPoints1.push_back(blob1.getVertex(i));
+				matchedPoints2.push_back(grid2.vertex(ind));
+			}
 		}
 	}
 
-	float computeDistance(cv::Point2f pt1, cv::Point2f pt2)
+	float computeDistance(const cv::Point2f &pt1, const cv::Point2f &pt2)
 	{
 		cv::Point2f vecTemp = pt1 - pt2;
 		return sqrt( (vecTemp.x*vecTemp.x) + (vecTemp.y*vecTemp.y) );
@@ -1442,11 +2217,20 @@ namespace Outils
 		return surface;
 	}
 
-	std::vector<Point2f> computeTranslate(std::vector<std::vector<KeyPt>> modifiedPoints, std::vector<std::vector<KeyPt>> points2Compare)
+	std::vector<Point2f> computeTranslate(const std::vector<std::vector<KeyPt>> &modifiedPoints, const std::vector<std::vector<KeyPt>> &points2Compare)
 	{
 		std::vector<Point2f> vecTranslate;
+
+		computeTranslate(modifiedPoints, points2Compare, vecTranslate);
+		return vecTranslate;
+	}
+
+	void computeTranslate(const std::vector<std::vector<KeyPt>> &modifiedPoints, const std::vector<std::vector<KeyPt>> &points2Compare, std::vector<Point2f> &vecTranslate)
+	{
 		Point2f translate;
 
+		vecTranslate.clear();
+
 		// Pour chaque blob
 		for (unsigned int i = 0; i < modifiedPoints.size(); ++i)
 		{
@@ -1466,8 +2250,6 @@ namespace Outils
 			// Ajout dans le vecteur  retourner
 			vecTranslate.push_back(translate);
 		}
-
-		return vecTranslate;
 	}
 
 	void substractRegion(Mat &src, Mat region2Substract)
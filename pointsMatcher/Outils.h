@@ -21,19 +21,122 @@
 #include <opencv2/nonfree/nonfree.hpp>
 
 #include "KeyPt.h";
+#include "KeyPtBlob.h"
+#include "HomographyRansac.h"
 
 using namespace cv;
 using namespace slAH;
 
 #define PI 3.141592653589793
 #define RADIUS_MIN 65
+#define RADIUS_PREDIT_MIN 8			// Rayon minimum autour des positions predites par l'homographie
+#define FACTEUR_RAYON_PREDIT 3		// Rayon predit = facteur * erreur mediane de l'homographie
+#define RATIO_AIRE_MAX 4			// Rapport maximum entre les aires de deux blobs qui peuvent se correspondre
 #define ERREUR_ANGLE_MAX 40
+#define TAILLE_DESCRIPTEUR 16		// Taille (en pixels) des KeyPoint donnes a l'extracteur de descripteurs
+#define HAMMING_MAX 128				// Distance de Hamming maximum entre les descripteurs de deux points qui se correspondent
+#define LSS_NB_POINTS_BLOC 16		// Points par appel de SelfSimDescriptor::compute (un bloc par thread)
+#define LSS_NB_POINTS_ANN 256		// A partir de ce nombre de points, les descripteurs LSS sont apparies par un kd-tree approximatif
 #define BEGIN_FRAME 0
 #define NB_FRAME_MEMORY 100
 
 namespace Outils
 {
+	// Grille uniforme sur les positions d'un ensemble de KeyPt, pour les recherches dans un rayon
+	// (RADIUS_MIN) : construite une seule fois, puis interrogee pour chaque point de l'autre image.
+	// La grille copie la position, la convexite et l'angle de chaque point, et garde des pointeurs
+	// sur les KeyPt (ou les KeyPtBlob) : les vecteurs ne doivent pas changer tant qu'elle sert.
+	// build() garde la memoire : une grille gardee d'une frame a l'autre ne fait plus d'allocation.
+	class KeyPtGrid
+	{
+	public:
+		KeyPtGrid();
+		KeyPtGrid(const std::vector<KeyPt> &keyPoints, float cellSize = RADIUS_MIN);
+
+		void build(const std::vector<KeyPt> &keyPoints, float cellSize = RADIUS_MIN);
+		void build(const std::vector<std::vector<KeyPt>> &vecKeyPoints, float cellSize = RADIUS_MIN);	// Tous les blobs, du dernier au premier
+		void build(const std::vector<KeyPtBlob> &vecBlobs, float cellSize = RADIUS_MIN);				// Tous les blobs, du dernier au premier
+		void query(const cv::Point2f &position, float radius, std::vector<int> &candidates) const;
+
+		// Cellules touchees par le carre de cote 2*radius autour de la position (vide si colMin > colMax)
+		void getCells(const cv::Point2f &position, float radius, int &colMin, int &colMax, int &rowMin, int &rowMax) const;
+		const int* beginCell(int col, int row) const { return &indexes_[0] + cellStart_[cellOf(col, row)]; }
+		const int* endCell(int col, int row) const { return &indexes_[0] + cellStart_[cellOf(col, row) + 1]; }
+
+		unsigned int size() const { return positions_.size(); }
+		const cv::Point2f& position(int index) const { return positions_[index]; }
+		int convexite(int index) const { return convexites_[index]; }
+		float angle(int index) const { return angles_[index]; }
+		const KeyPt& point(int index) const { return *points_[index]; }							// Grille de KeyPt
+		KeyPtVertex vertex(int index) const { return blobs_[index]->getVertex(vertices_[index]); }	// Grille de KeyPtBlob
+		int blobIndex(int index) const { return blobIndexes_[index]; }								// Grille de KeyPtBlob
+		const unsigned char* descriptor(int index) const { return descriptors_[index]; }			// NULL sans descripteur
+		int descriptorSize() const { return descriptorSize_; }										// En octets
+
+	private:
+		void clear(float cellSize);
+		void add(const cv::Point2f &position, int convexite, float angle, const unsigned char *descriptor = NULL);
+		void index();
+		int cellOf(int col, int row) const { return row * cols_ + col; }
+
+	private:
+		float cellSize_;
+		cv::Point2f origin_;				// Coin haut gauche de la grille
+		int cols_, rows_;
+		std::vector<cv::Point2f> positions_;	// Points indexes, dans l'ordre de build()
+		std::vector<int> convexites_;
+		std::vector<float> angles_;
+		std::vector<const unsigned char*> descriptors_;	// Lignes des descripteurs des KeyPtBlob
+		int descriptorSize_;
+		std::vector<const KeyPt*> points_;
+		std::vector<const KeyPtBlob*> blobs_;
+		std::vector<int> vertices_;
+		std::vector<int> blobIndexes_;
+		std::vector<int> cellStart_;		// Premier indice de chaque cellule dans indexes_, et la fin
+		std::vector<int> indexes_;			// Indices des points, cellule par cellule
+		std::vector<int> cells_, next_;
+	};
+
+	// Boundingbox d'un blob pour le balayage des paires de blobs
+	struct BlobBox
+	{
+		float xMin, xMax, yMin, yMax;
+		cv::Point2f centroid;
+		float area;
+		int index;
+		bool premier;		// Blob de la premiere image
+	};
+
+	// Tampons de matchBlobCandidates et matchBlobs, gardes par l'appelant d'une frame a l'autre
+	// comme la grille : les vecteurs gardent leur memoire.
+	// candidates a au moins un vecteur par blob de la premiere image (ceux en trop sont vides).
+	struct BlobMatchBuffers
+	{
+		std::vector<BlobBox> boxes;
+		std::vector<int> actifs1, actifs2;
+		std::vector<std::vector<int>> candidates;
+		std::vector<unsigned char> blobMask;
+	};
+
+	// Moteur RANSAC et ses tampons, gardes d'un appel a l'autre (un seul thread a la fois)
+	struct RansacBuffers
+	{
+		HomographyRansac ransac;
+		std::vector<cv::Point2f> points1, points2;
+		cv::Mat homography;
+		std::vector<float> erreurs;		// Erreur de chaque match, pour computeGateRadius
+	};
+
+	// Tampons de computeDescriptors, gardes par l'appelant d'une frame a l'autre
+	struct DescriptorBuffers
+	{
+		std::vector<cv::KeyPoint> keyPoints;
+		std::vector<std::pair<int, int>> sommets;		// Blob et sommet de chaque KeyPoint
+		cv::Mat descriptors;
+	};
+
 	std::vector<slKeyPoints> extractKeysPoints(const slContours &contours, const slBlobAnalyzer *ba);
+	std::vector<slKeyPoints> extractKeysPoints(const slContours &contours, const slBlobResult &result);
 	std::vector<cv::Point> extractPoints(std::vector<slKeyPoints> keysPoints);
 	std::vector<cv::Point> extractPoints(std::vector<KeyPoint> keysPoints);
 	void drawImage (std::vector<cv::Point> points, slImage3ch &output);
@@ -41,11 +144,14 @@ namespace Outils
 	void paint(const slImage1ch fg, const slContours &contours, const slBlobAnalyzer *ba, slImage3ch &output);
 	void paintKeyPoints(const slKeyPoints &kPt, cv::Scalar color, slImage3ch &output);
 	void paintKeyPoints(const slImage1ch fg, std::vector<std::vector<KeyPt>> vecKeyPts, cv::Scalar vertexColor, cv::Scalar edgeColor, slImage3ch &output);
+	void paintKeyPoints(const slImage1ch fg, const std::vector<KeyPtBlob> &vecBlobs, cv::Scalar vertexColor, cv::Scalar edgeColor, slImage3ch &output);
 	void writeMatToFile(cv::Mat& m, const std::string& filename);
 
 
 	CvMat* Ransac(std::vector<Point> &points1, std::vector<Point> &points2);
 	CvMat* Ransac(std::vector<KeyPt> &points1, std::vector<KeyPt> &points2);
+	CvMat* Ransac(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2);
+	bool Ransac(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, RansacBuffers &buffers, cv::Mat &transMat);
 
 	std::vector<CvMat*> CV_Ransac_Simple(std::vector<Point> points1, std::vector<Point> points2);
 
@@ -54,15 +160,21 @@ namespace Outils
 
 	std::vector<KeyPoint> extractKeyPoints(std::vector<slKeyPoints> keysPoints);
 
-	std::vector<Point> pointsTransform(std::vector<Point> points, cv::Mat transMat);
-	std::vector<KeyPt> pointsTransform(std::vector<KeyPt> points, cv::Mat transMat);
-	std::vector<std::vector<KeyPt>> pointsTransform(std::vector<std::vector<KeyPt>> points, cv::Mat transMat);
-
-	float computeMeanEuclideanError(std::vector<Point> points1, std::vector<Point> points2, unsigned int frameNumber);
-	float computeMeanEuclideanError(std::vector<KeyPt> points1, std::vector<KeyPt> points2, unsigned int frameNumber);
-
-	void descriptorMatchLSS(slImage3ch im1, slImage3ch im2, std::vector<Point> &points1, std::vector<Point> &points2);
-	float LSSDescriptorDistance(std::vector<float> descriptor1, std::vector<float> descriptor2);
+	std::vector<Point> pointsTransform(const std::vector<Point> &points, const cv::Mat &transMat);
+	std::vector<KeyPt> pointsTransform(const std::vector<KeyPt> &points, const cv::Mat &transMat);
+	std::vector<std::vector<KeyPt>> pointsTransform(const std::vector<std::vector<KeyPt>> &points, const cv::Mat &transMat);
+	void pointsTransform(const std::vector<Point> &points, const cv::Mat &transMat, std::vector<Point> &modifiedPoints);
+	void pointsTransform(const std::vector<KeyPt> &points, const cv::Mat &transMat, std::vector<KeyPt> &modifiedPoints);
+	void pointsTransform(const std::vector<std::vector<KeyPt>> &points, const cv::Mat &transMat, std::vector<std::vector<KeyPt>> &modifiedPoints);
+	cv::Point2f pointTransform(const cv::Point2f &point, const cv::Mat &transMat);
+
+	float computeMeanEuclideanError(const std::vector<Point> &points1, const std::vector<Point> &points2, unsigned int frameNumber);
+	float computeMeanEuclideanError(const std::vector<KeyPt> &points1, const std::vector<KeyPt> &points2, unsigned int frameNumber);
+
+	void descriptorMatchLSS(const slImage3ch &im1, const slImage3ch &im2, const std::vector<Point> &points1, std::vector<Point> &points2);
+	void computeLSSDescriptors(const slImage3ch &im, const std::vector<Point> &points, cv::Mat &descriptors);
+	void matchLSSDescriptors(const cv::Mat &descriptors1, const cv::Mat &descriptors2, std::vector<int> &indexes);
+	float LSSDescriptorDistance(const std::vector<float> &descriptor1, const std::vector<float> &descriptor2);
 	std::vector<KeyPt> convert2KeyPt(std::vector<slKeyPoint> &sortedKeysPoints);
 
 	void computeBlobBoundingBox(cv::Point2f &bbMin, cv::Point2f &bbMax, std::vector<slKeyPoint> &sortedKeysPoints);
@@ -71,21 +183,46 @@ namespace Outils
 	std::vector<slKeyPoint> sortKeyPoints(slKeyPoints &keysPoints);
 
 	void convertAndSortKeyPoints(std::vector<slKeyPoints> &keys, std::vector<std::vector<KeyPt>> &vecNewKeyPts);
+	void convertPolygons(const slContours &contours, const slDce *dce, std::vector<std::vector<KeyPt>> &vecNewKeyPts);
+	void convertPolygons(const slContours &contours, const slDce *dce, const slBlobResult &result, std::vector<std::vector<KeyPt>> &vecNewKeyPts);
+	void convertKeyPoints(const slContours &contours, const slBlobAnalyzer *ba, std::vector<std::vector<KeyPt>> &vecNewKeyPts);
+	void convertKeyPoints(const slContours &contours, const slBlobResult &result, std::vector<std::vector<KeyPt>> &vecNewKeyPts);
+	std::vector<KeyPt> convert2KeyPt(const std::vector<slDceVertex> &polygon);
+	// Les versions KeyPtBlob remplacent le contenu de vecBlobs en reutilisant ses blobs ; les blobs en trop restent vides
+	void convertPolygons(const slContours &contours, const slDce *dce, const slBlobResult &result, std::vector<KeyPtBlob> &vecBlobs);
+	void convertKeyPoints(const slContours &contours, const slBlobResult &result, std::vector<KeyPtBlob> &vecBlobs);
+	void convert2KeyPt(const std::vector<slDceVertex> &polygon, KeyPtBlob &blob);
+	void computeDescriptors(const slImage1ch &fg, const cv::DescriptorExtractor &extractor, std::vector<KeyPtBlob> &vecBlobs);
+	void computeDescriptors(const slImage1ch &fg, const cv::DescriptorExtractor &extractor, DescriptorBuffers &buffers, std::vector<KeyPtBlob> &vecBlobs);
 
 	float rad2Deg(float radian);
 	float deg2Rad(float degree);
 
-	std::vector<cv::Point2f> getCentroid(std::vector<std::vector<KeyPt>> keyPoints);
-	cv::Point2f getCentroid(std::vector<KeyPt> keyPoints);
+	std::vector<cv::Point2f> getCentroid(const std::vector<std::vector<KeyPt>> &keyPoints);
+	void getCentroid(const std::vector<std::vector<KeyPt>> &keyPoints, std::vector<cv::Point2f> &centroids);
+	cv::Point2f getCentroid(const std::vector<KeyPt> &keyPoints);
 	cv::Point2f getCentroid(std::vector<slKeyPoint> &keyPoints);
 
 	float determinerAngle(cv::Point2f vect1, cv::Point2f vect2, cv::Point2f vect3);
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2);
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2);
-	void matchBlobs(std::vector<std::vector<KeyPt>> vecKeyPoints1, std::vector<std::vector<KeyPt>> vecKeyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2);
-	void matchPoints(std::vector<KeyPt> keyPoints1, std::vector<KeyPt> keyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2);
-	void matchPoints(std::vector<KeyPt> keyPoints1, std::vector<KeyPt> keyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2);
-	float computeDistance(cv::Point2f pt1, cv::Point2f pt2);
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2);
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2);
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, KeyPtGrid &grid2, std::vector<std::vector<KeyPt>> &matchedPoints1, std::vector<std::vector<KeyPt>> &matchedPoints2);
+	void matchBlobs(const std::vector<std::vector<KeyPt>> &vecKeyPoints1, const std::vector<std::vector<KeyPt>> &vecKeyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2);
+	// Les versions KeyPtBlob remplacent les matches : un vecteur par blob de vecBlobs1 (ceux en trop restent vides)
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, KeyPtGrid &grid2, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2);
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, KeyPtGrid &grid2, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2);
+	void matchBlobs(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, KeyPtGrid &grid2, BlobMatchBuffers &buffers, std::vector<std::vector<KeyPtVertex>> &matchedPoints1, std::vector<std::vector<KeyPtVertex>> &matchedPoints2);
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const std::vector<KeyPt> &keyPoints2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2);
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const std::vector<KeyPt> &keyPoints2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2);
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const KeyPtGrid &grid2, std::vector<Point> &matchedPoints1, std::vector<Point> &matchedPoints2);
+	void matchPoints(const std::vector<KeyPt> &keyPoints1, const KeyPtGrid &grid2, std::vector<KeyPt> &matchedPoints1, std::vector<KeyPt> &matchedPoints2);
+	void matchPoints(const KeyPtBlob &blob1, const KeyPtGrid &grid2, std::vector<KeyPtVertex> &matchedPoints1, std::vector<KeyPtVertex> &matchedPoints2);
+	void matchPoints(const KeyPtBlob &blob1, const KeyPtGrid &grid2, const cv::Mat &transMat, float radius, std::vector<KeyPtVertex> &matchedPoints1, std::vector<KeyPtVertex> &matchedPoints2, const std::vector<unsigned char> *blobMask = NULL);
+	void matchBlobCandidates(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, std::vector<std::vector<int>> &candidates);
+	void matchBlobCandidates(const std::vector<KeyPtBlob> &vecBlobs1, const std::vector<KeyPtBlob> &vecBlobs2, const cv::Mat &transMat, float radius, BlobMatchBuffers &buffers);
+	float computeGateRadius(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, const cv::Mat &transMat);
+	float computeGateRadius(const std::vector<KeyPtVertex> &points1, const std::vector<KeyPtVertex> &points2, const cv::Mat &transMat, RansacBuffers &buffers);
+	float computeDistance(const cv::Point2f &pt1, const cv::Point2f &pt2);
 
 	Point2f findBlobCentroid(Mat &src_gray);
 	void update_map( slImage3ch src, Mat &dest, Mat map_x, Mat map_y);
@@ -94,7 +231,8 @@ namespace Outils
 	void transformGroundTruth(Mat src, Mat &dest, string pathFile, string pathVisForegroundFile);
 	int computeBlobsSurface(Mat src);
 
-	std::vector<Point2f> computeTranslate(std::vector<std::vector<KeyPt>> modifiedPoints, std::vector<std::vector<KeyPt>> points2Compare);
+	std::vector<Point2f> computeTranslate(const std::vector<std::vector<KeyPt>> &modifiedPoints, const std::vector<std::vector<KeyPt>> &points2Compare);
+	void computeTranslate(const std::vector<std::vector<KeyPt>> &modifiedPoints, const std::vector<std::vector<KeyPt>> &points2Compare, std::vector<Point2f> &vecTranslate);
 	void substractRegion(Mat &src, Mat region2Substract);
 	int countWhitePixel(Mat &src);
 }
@@ -20,6 +20,8 @@ int main(int argc, char **argv)
 	argProcess
 		.addGlobal(slParamSpec("-i", "Video source", MANDATORY) << slSyntax("video.avi"))
 		.addGlobal(slParamSpec("-k", "Video source", MANDATORY) << slSyntax("video.avi"))
+		.addGlobal(slParamSpec("-g", "Search the matches around the positions predicted by the previous homography"))
+		.addGlobal(slParamSpec("-d", "Reject the matches whose binary descriptors (FREAK on the foregrounds) are too different"))
 		.addGlobal(slParamSpec("-h", "Help"));
 	slBgSub::fillAllParamSpecs(argHbgSub);
 	slContourEngine::fillParamSpecs(argHContour);
@@ -47,7 +49,9 @@ int main(int argc, char **argv)
 	slContourEngine *contourEngine = new slContourEngine;
 	slContourEngine *contourEngine2 = new slContourEngine;
 	slBlobAnalyzer *ba = NULL;
-	slBlobAnalyzer *ba2 = NULL;
+	slBlobResult blobs1, blobs2;	// Un seul blobAnalyzer pour les deux vidos
+	bool gating = false;
+	bool descriptors = false;
 	slWindow winGraph1("Graph from Vis contours"), winGraph2("Graph from IR contours"), winGraph3("Test"), winGraph4("Test2");
 
 	try {
@@ -60,6 +64,9 @@ int main(int argc, char **argv)
 			return 0;
 		}
 
+		gating = globalParams.isParsed("-g");
+		descriptors = globalParams.isParsed("-d");
+
 		// Configure all compute nodes and others
 		videoIn.open(globalParams.getValue("-i").c_str());
 		videoIn2.open(globalParams.getValue("-k").c_str());
@@ -68,7 +75,6 @@ int main(int argc, char **argv)
 		contourEngine->setParameters(argProcess.getParameters("contour"));
 		contourEngine2->setParameters(argProcess.getParameters("contour"));
 		ba = slBlobAnalyzerFactory::createInstance(argProcess.getParameters("blobAn"));
-		ba2 = slBlobAnalyzerFactory::createInstance(argProcess.getParameters("blobAn"));
 
 		// Show configuration
 		bgSub->showParameters();
@@ -94,6 +100,7 @@ int main(int argc, char **argv)
 		slImage3ch imSource, imSource2, imDest, imDest2, imDest3, imDest4, imDest5, imDest6, fg3ch1, fg3ch2, fg1, fg2;
 		slImage3ch imContour, imContour2;
 		slImage1ch bForeground, bForeground2;
+		slImage1ch fgDescripteurs, fgDescripteurs2;	// Copies des avant-plans pour les descripteurs (findContours modifie l'image)
 
 		horloge.setFPS(videoIn.getFPS());
 		horloge.start();
@@ -102,19 +109,24 @@ int main(int argc, char **argv)
 		std::vector<slKeyPoints> keys;
 		std::vector<cv::Point> points1, points2;
 		std::vector<std::vector<KeyPt>> modifiedPoints;
-		std::vector<KeyPoint> keypointsA, keypointsB;
 
-		std::vector<std::vector<KeyPt>> vecNewKeyPts, vecNewKeyPts2, vecNewKeyPtsTemp;
+		std::vector<std::vector<KeyPt>> vecNewKeyPtsTemp;
+		std::vector<KeyPtBlob> vecNewKeyPts, vecNewKeyPts2;
 		std::vector<KeyPt> newKeyPts;
-		std::vector<KeyPt> vTemp1, vTemp2;
+		std::vector<KeyPtVertex> vTemp1, vTemp2;
 		std::vector<Point2f> translateVec;
 
-		std::vector<std::vector<KeyPt>> matchedPoints1, matchedPoints2, matchedPointsTemp1, matchedPointsTemp2;
-		std::vector<std::vector<KeyPt>> vecMatchedPoints1, vecMatchedPoints2;
+		std::vector<std::vector<KeyPtVertex>> matchedPoints1, matchedPoints2;
+		KeyPtGrid grid2;	// Grille des points de la deuxime image, garde d'une frame  l'autre
+		BlobMatchBuffers blobBuffers;		// Tampons du matching des blobs, gards aussi
+		RansacBuffers ransacBuffers;		// Moteur RANSAC et ses tampons, gards aussi
+		DescriptorBuffers descriptorBuffers;	// Tampons des descripteurs, gards aussi
+		cv::Mat predTransMat;				// Homographie de la frame prcdente (vide : pas de prdiction)
+		float predRadius = RADIUS_MIN;		// Rayon de recherche autour des positions prdites
+		std::vector<std::vector<KeyPtVertex>> vecMatchedPoints1, vecMatchedPoints2;
 		std::vector< std::pair< int, std::vector<int> > > matchedBlobs, matchedBlobs2;
 
-		Mat FREAKdescriptors1, FREAKdescriptors2;
-		std::vector<DMatch> matches;
+		FREAK freak(false);		// Sans normalisation de l'orientation : les deux camras ont la mme orientation
 		unsigned int nbMatch;
 
 		// Variables pour le calcul de centre de masse des blobs
@@ -189,6 +201,12 @@ int main(int argc, char **argv)
 			bgSub->compute(imSource, bForeground);
 			bgSub2->compute(imSource2, bForeground2);
 
+			if (descriptors)
+			{
+				bForeground.copyTo(fgDescripteurs);
+				bForeground2.copyTo(fgDescripteurs2);
+			}
+
 			fg3ch1.zeros(imSource.size().width, imSource.size().height);
 			fg3ch2.zeros(imSource.size().width, imSource.size().height);
 			fg1.zeros(imSource.size().width, imSource.size().height);
@@ -202,8 +220,7 @@ int main(int argc, char **argv)
 			min(fg3ch1, bgSub->getCurrent(), fg3ch1);
 			min(fg3ch2, bgSub2->getCurrent(), fg3ch2);
 
-			vecNewKeyPts.clear();
-			vecNewKeyPts2.clear();
+			// Pas de clear() des blobs ni des matches : convertKeyPoints et matchBlobs les rutilisent d'une frame  l'autre
 
 
 			if (ind >= BEGIN_FRAME)
@@ -212,29 +229,28 @@ int main(int argc, char **argv)
 				contourEngine->findContours(bForeground);
 				contourEngine2->findContours(bForeground2);
 
-				ba->analyzeAllBlobs(contourEngine->getContours());
-				ba2->analyzeAllBlobs(contourEngine2->getContours());
+				ba->analyze(contourEngine->getContours(), blobs1);
+				ba->analyze(contourEngine2->getContours(), blobs2);
 
-				keys = extractKeysPoints(contourEngine->getContours(), ba);
-
-				if (keys.size() > 0)
+				if (!contourEngine->getContours().begin().isNull())
 				{
-					convertAndSortKeyPoints(keys, vecNewKeyPts);
+					convertKeyPoints(contourEngine->getContours(), blobs1, vecNewKeyPts);
+
+					if (descriptors)
+						computeDescriptors(fgDescripteurs, freak, descriptorBuffers, vecNewKeyPts);
 
 					paintKeyPoints(bForeground, vecNewKeyPts, CV_RGB(0, 255, 0), CV_RGB(0, 0, 255), imContour);
 					winGraph1.show(imContour);
 
-					keys.clear();
+					convertKeyPoints(contourEngine2->getContours(), blobs2, vecNewKeyPts2);
 
-					keys = extractKeysPoints(contourEngine2->getContours(), ba2);
-					convertAndSortKeyPoints(keys, vecNewKeyPts2);
+					if (descriptors)
+						computeDescriptors(fgDescripteurs2, freak, descriptorBuffers, vecNewKeyPts2);
 
 					paintKeyPoints(bForeground2, vecNewKeyPts2, CV_RGB(0, 0, 255), CV_RGB(255, 0, 0), imContour2);
 					winGraph2.show(imContour2);
 
-					matchBlobs(vecNewKeyPts, vecNewKeyPts2, matchedPoints1, matchedPoints2);
-					matchedPointsTemp1 = matchedPoints1;
-					matchedPointsTemp2 = matchedPoints2;
+					matchBlobs(vecNewKeyPts, vecNewKeyPts2, predTransMat, predRadius, grid2, blobBuffers, matchedPoints1, matchedPoints2);
 
 					// Transformation de plusieurs vecteurs en un seul
 					for (unsigned int it = 0; it < matchedPoints1.size(); ++it)
@@ -243,8 +259,19 @@ int main(int argc, char **argv)
 						vTemp2.insert(vTemp2.end(), matchedPoints2.at(it).begin(), matchedPoints2.at(it).end());
 					}
 
-					vecMatchedPoints1.push_back(vTemp1);
-					vecMatchedPoints2.push_back(vTemp2);
+					// Les NB_FRAME_MEMORY dernires frames : le vecteur de la plus ancienne est rutilis pour la nouvelle
+					if (vecMatchedPoints1.size() == NB_FRAME_MEMORY)
+					{
+						std::rotate(vecMatchedPoints1.begin(), vecMatchedPoints1.begin() + 1, vecMatchedPoints1.end());
+						std::rotate(vecMatchedPoints2.begin(), vecMatchedPoints2.begin() + 1, vecMatchedPoints2.end());
+						vecMatchedPoints1.back() = vTemp1;
+						vecMatchedPoints2.back() = vTemp2;
+					}
+					else
+					{
+						vecMatchedPoints1.push_back(vTemp1);
+						vecMatchedPoints2.push_back(vTemp2);
+					}
 
 					// Copie de tous les points des autres frames dans un seul vecteur
 					for (unsigned int i = 0; i < vecMatchedPoints1.size() - 1; ++i)
@@ -253,10 +280,16 @@ int main(int argc, char **argv)
 						vTemp2.insert(vTemp2.end(), vecMatchedPoints2.at(i).begin(), vecMatchedPoints2.at(i).end());
 					}
 
-					if (vecMatchedPoints1.size() == NB_FRAME_MEMORY)
+					// Homographie de cette frame pour prdire les positions des points  la frame suivante
+					if (gating)
 					{
-						vecMatchedPoints1.erase(vecMatchedPoints1.begin());
-						vecMatchedPoints2.erase(vecMatchedPoints2.begin());
+						predRadius = RADIUS_MIN;
+
+						// predTransMat garde sa mmoire d'une frame  l'autre, vide seulement sans homographie
+						if (vTemp1.size() >= 4 && Ransac(vTemp1, vTemp2, ransacBuffers, predTransMat))
+							predRadius = computeGateRadius(vTemp1, vTemp2, predTransMat, ransacBuffers);
+						else
+							predTransMat.release();
 					}
 
 					if (vTemp1.size() >= 4)
@@ -264,57 +297,58 @@ int main(int argc, char **argv)
 						if (ind == 649)
 						{
 
-							CvMat* trans = Ransac(vTemp1, vTemp2);
-
-							cv::Mat transMat = (cv::Mat)trans;
-							transMat.convertTo(transMat, CV_32FC1, 1, 0);	// Convertir la matrice en float
+							cv::Mat transMat;	// Matrice en float
 
-							cv::warpPerspective(fg1, imDest, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
-							cv::warpPerspective(fg3ch1, imDest2, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
-							cv::warpPerspective(imContour, imDest5, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
+							// Pas d'homographie (moins de 4 inliers) : pas de transformation pour cette frame
+							if (Ransac(vTemp1, vTemp2, ransacBuffers, transMat))
+							{
+								cv::warpPerspective(fg1, imDest, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
+								cv::warpPerspective(fg3ch1, imDest2, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
+								cv::warpPerspective(imContour, imDest5, transMat, cv::Size(imSource.size().width, imSource.size().height), 1, 0);
 
 
-							string pathFile = "..\\SDK_LITIV\\mediaFiles\\GroundTruth\\vid3\\1Person\\vid3_1Person.txt";
-							string pathVisForegroundFile = "vid3\\\\1Person\\\\Foreground\\\\VisForeground236.jpg";
+								string pathFile = "..\\SDK_LITIV\\mediaFiles\\GroundTruth\\vid3\\1Person\\vid3_1Person.txt";
+								string pathVisForegroundFile = "vid3\\\\1Person\\\\Foreground\\\\VisForeground236.jpg";
 
-							groundTruthIm = fg1.clone();
-							transformGroundTruth(fg1, groundTruthIm, pathFile, pathVisForegroundFile);
+								groundTruthIm = fg1.clone();
+								transformGroundTruth(fg1, groundTruthIm, pathFile, pathVisForegroundFile);
 
-							cvtColor(groundTruthIm, src_gray2, CV_BGR2GRAY);
-							centr = findBlobCentroid(src_gray2);
+								cvtColor(groundTruthIm, src_gray2, CV_BGR2GRAY);
+								centr = findBlobCentroid(src_gray2);
 
-							// Ground truth foreground
-							winGraph1.show(src_gray2);
+								// Ground truth foreground
+								winGraph1.show(src_gray2);
 
-							cvtColor(imDest, src_gray, CV_BGR2GRAY);
-							centr = findBlobCentroid(src_gray);
+								cvtColor(imDest, src_gray, CV_BGR2GRAY);
+								centr = findBlobCentroid(src_gray);
 
-							// Transformed IR foreground
-							winGraph2.show(src_gray);
+								// Transformed IR foreground
+								winGraph2.show(src_gray);
 
-							//forgroundIR_On_GroundTruth
-							subtract(groundTruthIm, imDest2, imDest3, noArray(), 1);
-							imOut1.write(imDest3);
+								//forgroundIR_On_GroundTruth
+								subtract(groundTruthIm, imDest2, imDest3, noArray(), 1);
+								imOut1.write(imDest3);
 
-							// forgroundIR_On_foregroundVis
-							add(imDest2, fg3ch2, imDest4, noArray(), 1);
-							winGraph3.show(imDest4);
-							imOut2.write(imDest4);
-							//record.write(imDest4);
-							// contoursIR_On_contoursVis
-							add(imDest5, imContour2, imDest6, noArray(), 1);
-							winGraph4.show(imDest6);
-							imOut3.write(imDest6);
+								// forgroundIR_On_foregroundVis
+								add(imDest2, fg3ch2, imDest4, noArray(), 1);
+								winGraph3.show(imDest4);
+								imOut2.write(imDest4);
+								//record.write(imDest4);
+								// contoursIR_On_contoursVis
+								add(imDest5, imContour2, imDest6, noArray(), 1);
+								winGraph4.show(imDest6);
+								imOut3.write(imDest6);
 
-							add(imDest, groundTruthIm, imDest6, noArray(), 1);
+								add(imDest, groundTruthIm, imDest6, noArray(), 1);
 
 
-							int count1 = countWhitePixel(groundTruthIm);
-							int count2 = countWhitePixel(imDest6);
+								int count1 = countWhitePixel(groundTruthIm);
+								int count2 = countWhitePixel(imDest6);
 
-							float blobRatio = (float)count2 / (float)count1;
+								float blobRatio = (float)count2 / (float)count1;
 
-							std::cout << std::endl << "Blob Ratio = " << count2 << "/" << count1 << " = " << blobRatio << std::endl;
+								std::cout << std::endl << "Blob Ratio = " << count2 << "/" << count1 << " = " << blobRatio << std::endl;
+							}
 
 							//waitKey();
 						}
@@ -327,8 +361,6 @@ int main(int argc, char **argv)
 
 					//waitKey();
 
-					matchedPoints1.clear();
-					matchedPoints2.clear();
 					modifiedPoints.clear();
 
 				}